@@ -0,0 +1,270 @@
+// Parse benchmarks for clags with glibc getopt_long as a baseline.
+// Every scenario runs in its own child process, so peak memory is measured per scenario.
+// Results are printed as CSV on stdout, one row per scenario and parser.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+#define BENCH_MIN_SECONDS 0.2
+#define BENCH_MAX_REPS 1000
+
+typedef enum{
+    Bench_Options,
+    Bench_Types,
+    Bench_List,
+    Bench_Clusters,
+} bench_kind_t;
+
+typedef struct{
+    const char *name;
+    bench_kind_t kind;
+    clags_value_type_t value_type;
+    size_t options;
+    size_t tokens;
+} bench_scenario_t;
+
+typedef struct{
+    size_t allocs;
+    size_t bytes;
+} bench_counter_t;
+
+static void *bench_alloc(void *ctx, size_t size)
+{
+    bench_counter_t *counter = (bench_counter_t*) ctx;
+    counter->allocs++;
+    counter->bytes += size;
+    return malloc(size);
+}
+
+static void *bench_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    bench_counter_t *counter = (bench_counter_t*) ctx;
+    counter->allocs++;
+    if (new_size > old_size) counter->bytes += new_size - old_size;
+    return realloc(ptr, new_size);
+}
+
+static void bench_free(void *ctx, void *ptr, size_t size)
+{
+    (void) ctx;
+    (void) size;
+    free(ptr);
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static char *bench_strdup(const char *fmt, size_t value)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), fmt, value);
+    return strdup(buf);
+}
+
+// positional values must not start with '-', as they would be read as flags
+static const char *bench_value(clags_value_type_t type, size_t i, bool positive)
+{
+    static char buf[64];
+    int offset = positive? 0:1;
+    switch(type){
+        case Clags_Bool:   return i%2? "true":"false";
+        case Clags_Int8:   snprintf(buf, sizeof(buf), "%d", (int)(i%128)-128*offset); break;
+        case Clags_UInt8:  snprintf(buf, sizeof(buf), "%u", (unsigned)(i%256)); break;
+        case Clags_Int32:  snprintf(buf, sizeof(buf), "%d", (int)(i*7919%2000000)-1000000*offset); break;
+        case Clags_UInt32: snprintf(buf, sizeof(buf), "%zu", i*7919%4000000000u); break;
+        case Clags_Double: snprintf(buf, sizeof(buf), "%.3f", i*0.125); break;
+        default:           snprintf(buf, sizeof(buf), "value%zu", i); break;
+    }
+    return buf;
+}
+
+static size_t bench_type_size(clags_value_type_t type)
+{
+    switch(type){
+        case Clags_Bool:   return sizeof(bool);
+        case Clags_Int8:   return sizeof(int8_t);
+        case Clags_UInt8:  return sizeof(uint8_t);
+        case Clags_Int32:  return sizeof(int32_t);
+        case Clags_UInt32: return sizeof(uint32_t);
+        case Clags_Double: return sizeof(double);
+        default:           return sizeof(char*);
+    }
+}
+
+// builds the clags argument table, the matching getopt_long table and the argv for a scenario
+static size_t bench_build(bench_scenario_t sc, clags_arg_t **pargs, struct option **plong, char **pshort, char ***pargv, int *pargc, clags_list_t *list)
+{
+    static char storage[5000][16];
+    size_t arg_count = 0;
+    clags_arg_t *args = calloc(sc.options+32, sizeof(*args));
+    struct option *longopts = calloc(sc.options+32, sizeof(*longopts));
+    char *shortopts = calloc(64, 1);
+    char **argv = calloc(sc.tokens+2, sizeof(*argv));
+    int argc = 0;
+    argv[argc++] = "bench";
+
+    switch(sc.kind){
+        case Bench_Options:
+        case Bench_Types:{
+            for (size_t i=0; i<sc.options; ++i){
+                char *flag = bench_strdup("--option-%zu", i);
+                args[arg_count++] = (clags_arg_t){.type=Clags_Optional, .opt=(clags_opt_t){.long_flag=flag, .value=storage[i], .value_type=sc.value_type, .field_name="V", .description="option"}};
+                longopts[i] = (struct option){.name=flag+2, .has_arg=required_argument, .val=0};
+            }
+            for (size_t i=0; argc+1<(int)sc.tokens+1; ++i){
+                size_t option = i*2654435761u % sc.options;
+                argv[argc++] = bench_strdup("--option-%zu", option);
+                argv[argc++] = strdup(bench_value(sc.value_type, i, false));
+            }
+        } break;
+        case Bench_List:{
+            list->item_size = bench_type_size(sc.value_type);
+            args[arg_count++] = (clags_arg_t){.type=Clags_Required, .req=(clags_req_t){.name="items", .value=list, .value_type=sc.value_type, .is_list=true, .description="items"}};
+            for (size_t i=0; i<sc.options; ++i){
+                char *flag = bench_strdup("--option-%zu", i);
+                args[arg_count++] = (clags_arg_t){.type=Clags_Optional, .opt=(clags_opt_t){.long_flag=flag, .value=storage[i], .field_name="V", .description="option"}};
+                longopts[i] = (struct option){.name=flag+2, .has_arg=required_argument, .val=0};
+            }
+            for (size_t i=0; i<sc.tokens; ++i) argv[argc++] = strdup(bench_value(sc.value_type, i, true));
+        } break;
+        case Bench_Clusters:{
+            static bool flags[26];
+            static char names[26][3];
+            for (size_t i=0; i<26; ++i){
+                names[i][0] = '-';
+                names[i][1] = (char)('a'+i);
+                args[arg_count++] = (clags_arg_t){.type=Clags_Flag, .flag=(clags_flag_t){.short_flag=names[i], .value=&flags[i], .description="flag"}};
+                shortopts[i] = (char)('a'+i);
+            }
+            for (size_t i=0; i<sc.tokens; ++i){
+                char buf[16] = "-";
+                for (size_t j=1; j<9; ++j) buf[j] = (char)('a'+(i*7+j*3)%26);
+                argv[argc++] = strdup(buf);
+            }
+        } break;
+    }
+    *pargs = args;
+    *plong = longopts;
+    *pshort = shortopts;
+    *pargv = argv;
+    *pargc = argc;
+    return arg_count;
+}
+
+static void bench_run(bench_scenario_t sc, bool baseline)
+{
+    clags_arg_t *args;
+    struct option *longopts;
+    char *shortopts;
+    char **argv;
+    int argc;
+    clags_list_t list = clags_list;
+    size_t arg_count = bench_build(sc, &args, &longopts, &shortopts, &argv, &argc, &list);
+    char **copy = malloc((argc+1)*sizeof(*copy));
+
+    bench_counter_t counter = {0};
+    clags_allocator_t allocator = {.alloc=bench_alloc, .realloc=bench_realloc, .free=bench_free, .ctx=&counter};
+    clags_settings_t settings = {.allocator=&allocator};
+    clags_spec_t spec;
+    if (!baseline && !clags__compile(&spec, args, arg_count, &allocator)) exit(1);
+
+    double best = 1e30, total = 0;
+    size_t reps = 0, allocs = 0, bytes = 0;
+    while (reps < BENCH_MAX_REPS && (total < BENCH_MIN_SECONDS || reps < 3)){
+        memcpy(copy, argv, argc*sizeof(*copy));
+        counter = (bench_counter_t){0};
+        double start = bench_now();
+        if (baseline){
+            optind = 0;
+            opterr = 0;
+            int c, index;
+            while ((c = getopt_long(argc, copy, shortopts, longopts, &index)) != -1){
+                if (c == '?') exit(1);
+                if (c == 0 && sc.kind == Bench_Types){
+                    // getopt only splits, so convert like an application would
+                    if (sc.value_type == Clags_Double) (void) strtod(optarg, NULL);
+                    else if (sc.value_type != Clags_None && sc.value_type != Clags_Bool) (void) strtol(optarg, NULL, 10);
+                }
+            }
+            if (sc.kind == Bench_List){
+                for (int i=optind; i<argc; ++i){
+                    if (sc.value_type == Clags_Double) (void) strtod(copy[i], NULL);
+                    else if (sc.value_type != Clags_None) (void) strtol(copy[i], NULL, 10);
+                }
+            }
+        } else{
+            if (!clags_parse_with(argc, copy, &spec, &settings)) exit(1);
+            clags_list_free(&list);
+        }
+        double elapsed = bench_now() - start;
+        if (elapsed < best) best = elapsed;
+        total += elapsed;
+        allocs = counter.allocs;
+        bytes = counter.bytes;
+        reps++;
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%s,%s,%s,%zu,%d,%.2f,%zu,%zu,%ld\n", sc.name, baseline? "getopt_long":"clags",
+           sc.value_type == Clags_None? "string":clags__type_names[sc.value_type],
+           sc.options, argc-1, best*1e9/(argc-1), allocs, bytes, usage.ru_maxrss);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = argc > 1? argv[1]:NULL;
+    bench_scenario_t scenarios[] = {
+        {"options", Bench_Options, Clags_None, 10,   10},
+        {"options", Bench_Options, Clags_None, 10,   10000},
+        {"options", Bench_Options, Clags_None, 10,   1000000},
+        {"options", Bench_Options, Clags_None, 100,  10000},
+        {"options", Bench_Options, Clags_None, 1000, 10000},
+        {"options", Bench_Options, Clags_None, 5000, 10},
+        {"options", Bench_Options, Clags_None, 5000, 10000},
+        {"types",   Bench_Types,   Clags_Bool,   10, 100000},
+        {"types",   Bench_Types,   Clags_Int8,   10, 100000},
+        {"types",   Bench_Types,   Clags_UInt8,  10, 100000},
+        {"types",   Bench_Types,   Clags_Int32,  10, 100000},
+        {"types",   Bench_Types,   Clags_UInt32, 10, 100000},
+        {"types",   Bench_Types,   Clags_Double, 10, 100000},
+        {"list",    Bench_List,    Clags_None,   10, 1000000},
+        {"list",    Bench_List,    Clags_Int32,  10, 10},
+        {"list",    Bench_List,    Clags_Int32,  10, 1000000},
+        {"list",    Bench_List,    Clags_Double, 10, 1000000},
+        {"clusters", Bench_Clusters, Clags_None, 26, 100000},
+    };
+    printf("scenario,parser,type,options,tokens,ns_per_token,allocs,alloc_bytes,peak_rss_kb\n");
+    fflush(stdout);
+    for (size_t i=0; i<clags_arr_len(scenarios); ++i){
+        if (filter && strcmp(filter, scenarios[i].name) != 0) continue;
+        for (int baseline=0; baseline<2; ++baseline){
+            pid_t pid = fork();
+            if (pid == 0){
+                bench_run(scenarios[i], baseline);
+                exit(0);
+            }
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+                fprintf(stderr, "[ERROR] Scenario '%s' failed for %s!\n", scenarios[i].name, baseline? "getopt_long":"clags");
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
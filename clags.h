@@ -27,6 +27,11 @@
 #ifndef CLAGS_H
 #define CLAGS_H
 
+// the implementation uses POSIX calls that strict modes like -std=c11 hide, unless a system header came first
+#if defined(CLAGS_IMPLEMENTATION) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -35,18 +40,52 @@
 #include <assert.h>
 #include <errno.h>
 #include <float.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef bool (*clags_value_func_t)(const char *arg_name, const char *arg, void *pvalue);
-typedef bool (*clags_value_verify_t) (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
 
-bool clags__verify_none   (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
-bool clags__verify_custom (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
-bool clags__verify_bool   (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
-bool clags__verify_int8   (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
-bool clags__verify_uint8  (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
-bool clags__verify_int32  (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
-bool clags__verify_uint32 (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
-bool clags__verify_double (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func);
+typedef enum{
+    Clags_Error_None,
+    Clags_Error_InvalidValue,
+    Clags_Error_OutOfRange,
+    Clags_Error_Rejected,
+    Clags_Error_MissingValue,
+    Clags_Error_UnknownOption,
+    Clags_Error_UnknownFlag,
+    Clags_Error_TooManyArguments,
+    Clags_Error_MissingArguments,
+    Clags_Error_ListFull,
+    Clags_Error_Memory,
+    Clags_Error_ResponseFile,
+    Clags_Error_Input,
+    Clags_Error_UnknownCommand,
+} clags_error_code_t;
+
+#ifndef CLAGS_ERROR_MESSAGE_SIZE
+#define CLAGS_ERROR_MESSAGE_SIZE 256
+#endif
+
+// a parse error; index is the argv index of the offending token, or argc for errors at the end of input
+typedef struct{
+    clags_error_code_t code;
+    size_t index;
+    char message[CLAGS_ERROR_MESSAGE_SIZE];
+} clags_error_t;
+
+typedef bool (*clags_value_verify_t) (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
+
+bool clags__verify_none   (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
+bool clags__verify_custom (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
+bool clags__verify_bool   (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
+bool clags__verify_int8   (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
+bool clags__verify_uint8  (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
+bool clags__verify_int32  (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
+bool clags__verify_uint32 (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
+bool clags__verify_double (const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error);
 
 #define clags__types\
     X(Clags_None,   clags__verify_none,    NULL)    \
@@ -65,13 +104,63 @@ typedef enum{
 } clags_value_type_t;
 #undef X
 
+// memory hooks; realloc and free receive the previous size of the block
+typedef struct{
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+} clags_allocator_t;
+
+typedef struct clags__arena_block_t clags__arena_block_t;
+
+// a bump allocator that releases everything at once, either on a caller-provided buffer or on the heap
+typedef struct{
+    clags__arena_block_t *blocks;
+    char *buffer;
+    size_t capacity;
+    size_t used;
+    void *last;
+} clags_arena_t;
+
 typedef struct{
     void *items;
     size_t item_size;
     size_t count;
     size_t capacity;
+    clags_allocator_t allocator;  // a copy of the allocator the list was first grown with
+    bool fixed;
+    struct clags__mapping_t *copies;  // copied values that string and custom items point into, freed with the list
 } clags_list_t;
 
+// receives every converted item of a streamed list; returning false aborts parsing
+typedef bool (*clags_item_func_t)(void *item, void *ctx);
+
+typedef struct{
+    clags_item_func_t func;
+    void *ctx;
+    size_t item_size;
+    size_t count;
+} clags_stream_t;
+
+typedef struct clags_completion_t clags_completion_t;
+
+// adds the candidates for a value starting with prefix through clags_complete_add
+typedef void (*clags_complete_func_t)(const char *prefix, clags_completion_t *completion);
+
+// called by clags_reconfigure after value was changed, old_value holds the previous value until it returns
+typedef void (*clags_change_func_t)(const char *arg_name, void *value, const void *old_value);
+
+// the raw value of a lazy argument, converted into its variable on first access, see clags_lazy_get
+typedef struct{
+    const char *token;  // NULL while the argument was not given
+    const char *name;
+    clags_value_type_t type;
+    clags_value_func_t func;
+    void *value;
+    bool pending;       // token has not been converted yet
+} clags_lazy_t;
+
 typedef struct{
     const char *name;
     clags_value_type_t value_type;
@@ -79,6 +168,12 @@ typedef struct{
     clags_value_func_t value_func;
     const char *description;
     bool is_list;
+    bool is_stream;
+    clags_complete_func_t complete;
+    clags_change_func_t on_change;
+    size_t value_size;  // size of a custom value, only needed by clags_reconfigure
+    clags_lazy_t *lazy;  // records the token while parsing instead of converting it, ignored by lists
+    bool thread_safe;    // value_func may run on several threads at once, so long lists are converted in parallel
 } clags_req_t;
 
 typedef struct{
@@ -89,6 +184,15 @@ typedef struct{
     clags_value_func_t value_func;
     const char *field_name;
     const char *description;
+    bool is_list;
+    char separator;
+    const char *env;         // environment variable used when the option is not given
+    const char *config_key;  // config file key used when neither the option nor env is given
+    clags_complete_func_t complete;
+    clags_change_func_t on_change;
+    size_t value_size;  // size of a custom value, only needed by clags_reconfigure
+    clags_lazy_t *lazy;  // records the token while parsing instead of converting it, ignored by lists
+    bool thread_safe;    // value_func may run on several threads at once, so long lists are converted in parallel
 } clags_opt_t;
 
 typedef struct{
@@ -97,64 +201,267 @@ typedef struct{
     bool *value;
     const char *description;
     bool exit;
+    clags_change_func_t on_change;
 } clags_flag_t;
 
+typedef struct clags_arg_t clags_arg_t;
+
+// a subcommand with its own argument table, which is only compiled when the command is selected
 typedef struct{
-    clags_req_t *required;
-    size_t required_count;
-    clags_opt_t *optional;
-    size_t optional_count;
-    clags_flag_t *flags;
-    size_t flag_count;
-} clags_args_t;
+    const char *name;
+    bool *value;
+    clags_arg_t *args;
+    size_t arg_count;
+    const char *description;
+} clags_cmd_t;
 
 typedef enum{
     Clags_Required,
     Clags_Optional,
-    Clags_Flag
+    Clags_Flag,
+    Clags_Command
 } clags_arg_type_t;
 
-typedef struct{
+struct clags_arg_t{
     clags_arg_type_t type;
     union{
         clags_req_t req;
         clags_opt_t opt;
         clags_flag_t flag;
+        clags_cmd_t cmd;
     };
-} clags_arg_t;
+};
+
+typedef struct{
+    const char *flag;
+    uint32_t hash;
+    uint32_t length;
+    clags_arg_t *arg;
+} clags__index_entry_t;
+
+typedef struct clags_spec_t clags_spec_t;
+
+// finds the argument using the first length characters of flag, or returns NULL; replaces the flag index of a spec
+typedef clags_arg_t *(*clags_lookup_func_t)(const clags_spec_t *spec, const char *flag, size_t length);
+
+// a compiled argument table: the arguments sorted by kind and all flags indexed for O(1) lookup
+struct clags_spec_t{
+    clags_arg_t *args;
+    size_t arg_count;
+    clags_arg_t **required;
+    size_t required_count;
+    clags_arg_t **optional;
+    size_t optional_count;
+    clags_arg_t **flags;
+    size_t flag_count;
+    clags_arg_t **commands;
+    size_t command_count;
+    clags__index_entry_t *index;
+    size_t index_mask;
+    clags_lookup_func_t lookup;  // used instead of index when set, see clags_compile_lookup
+    clags_arg_t *short_flags[256];
+    clags__index_entry_t *env_index;
+    size_t env_mask;
+    bool fallbacks;  // some option names an env variable or config key
+    bool bare_flags; // some flag does not start with '-', so a plain token may still be a flag
+    bool lazy;       // some argument is converted on first access
+    void *memory;
+    clags_allocator_t allocator;
+    uint64_t compile_ns;  // not yet counted in any clags_stats_t
+    char *usage;          // rendered usage text, followed by the program name it was rendered for
+    size_t usage_length;
+    size_t usage_size;
+};
+
+typedef struct clags__mapping_t clags__mapping_t;
+
+// collects the response files opened during parsing, so they can be released together
+typedef struct{
+    clags__mapping_t *head;
+} clags_files_t;
+
+#ifndef CLAGS_RESPONSE_FILE_DEPTH
+#define CLAGS_RESPONSE_FILE_DEPTH 8
+#endif
+
+// total size and number of the response files read by one parse, which bound nested files that name each other repeatedly
+#ifndef CLAGS_RESPONSE_FILE_BUDGET
+#define CLAGS_RESPONSE_FILE_BUDGET ((size_t)256 << 20)
+#endif
+
+#ifndef CLAGS_RESPONSE_FILE_MAX
+#define CLAGS_RESPONSE_FILE_MAX 1024
+#endif
+
+// largest custom value that can be converted while only validating, see clags_parse_batch
+#ifndef CLAGS_VALIDATE_SCRATCH_SIZE
+#define CLAGS_VALIDATE_SCRATCH_SIZE 256
+#endif
+
+#ifndef CLAGS_MAX_THREADS
+#define CLAGS_MAX_THREADS 64
+#endif
+
+// lists of at least this many built-in values are converted on several threads, see clags_settings_t.threads
+#ifndef CLAGS_PARALLEL_THRESHOLD
+#define CLAGS_PARALLEL_THRESHOLD 16384
+#endif
+
+// the same for custom values whose function is marked thread_safe, which are assumed to wait on I/O
+#ifndef CLAGS_PARALLEL_CUSTOM_THRESHOLD
+#define CLAGS_PARALLEL_CUSTOM_THRESHOLD 64
+#endif
+
+typedef struct{
+    const char *key;
+    uint32_t hash;
+    uint32_t length;
+    char *value;
+} clags__config_entry_t;
+
+// a config file of "key = value" lines, mapped and indexed once; values point into the mapping
+typedef struct{
+    char *data;
+    size_t size;
+    bool mapped;
+    clags__config_entry_t *index;
+    size_t index_mask;
+    clags_allocator_t allocator;
+} clags_config_t;
+
+// parse statistics, only collected when compiled with CLAGS_STATS; all times in nanoseconds
+typedef struct{
+    uint64_t sort_ns;      // sorting and indexing the argument table (at compile time for compiled specs)
+    uint64_t match_ns;     // tokenizing and matching flags, i.e. everything but value conversion
+    uint64_t verify_ns;    // built-in value conversions
+    uint64_t custom_ns;    // custom value functions
+    size_t tokens;
+    size_t comparisons;    // full string comparisons against flags and separators
+    size_t list_reallocs;
+    size_t bytes_allocated;
+} clags_stats_t;
+
+// called for every token before it is processed, only with CLAGS_STATS
+typedef void (*clags_trace_func_t)(void *ctx, size_t index, const char *token);
+
+// per-call parse settings, a NULL pointer selects the defaults
+typedef struct{
+    const clags_allocator_t *allocator;
+    clags_files_t *files;
+    bool no_response_files;
+    const clags_config_t *config;
+    bool no_env;
+    clags_stats_t *stats;
+    clags_trace_func_t trace;
+    void *trace_ctx;
+    clags_error_t *error;  // collects the error instead of printing it to stderr
+    clags_arg_t **command; // receives the selected command, or NULL if none was given
+    size_t threads;        // threads for converting large lists, 0 for one per core and 1 to never start threads
+} clags_settings_t;
+
+// receives rendered text; returning false reports a failed write
+typedef bool (*clags_write_func_t)(void *ctx, const char *data, size_t size);
+
+typedef enum{
+    Clags_Output_Buffer,
+    Clags_Output_File,
+    Clags_Output_Fd,
+    Clags_Output_Func,
+} clags_output_kind_t;
+
+// a destination for rendered text; a buffer output appends at length and counts the full length even when truncated
+typedef struct{
+    clags_output_kind_t kind;
+    char *buffer;
+    size_t capacity;
+    size_t length;
+    FILE *file;
+    int fd;
+    clags_write_func_t func;
+    void *ctx;
+} clags_output_t;
+
+#ifndef CLAGS_COMPLETE_BUFFER_SIZE
+#define CLAGS_COMPLETE_BUFFER_SIZE 4096
+#endif
+
+#ifndef CLAGS_COMMAND_BUFFER_SIZE
+#define CLAGS_COMMAND_BUFFER_SIZE 8192
+#endif
+
+// the answer to a completion request, collected in a buffer and written in as few writes as possible
+struct clags_completion_t{
+    clags_output_t *output;
+    const char *prefix;  // the part of the word being completed that candidates have to start with
+    const char *lead;    // the part of the word in front of the prefix, e.g. "--output="
+    size_t lead_length;
+    char buffer[CLAGS_COMPLETE_BUFFER_SIZE];
+    size_t length;
+    bool failed;
+};
+
+#define clags_output_buffer(buf, size) (clags_output_t) {.kind=Clags_Output_Buffer, .buffer=(buf), .capacity=(size)}
+#define clags_output_file(f)           (clags_output_t) {.kind=Clags_Output_File, .file=(f)}
+#define clags_output_fd(d)             (clags_output_t) {.kind=Clags_Output_Fd, .fd=(d)}
+#define clags_output_func(f, c)        (clags_output_t) {.kind=Clags_Output_Func, .func=(f), .ctx=(c)}
 
 #define CLAGS_USAGE_ALIGNMENT -24
 
-#define clags_required(val, n, desc)               (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_None,.value_func=NULL,.is_list=false}}
-#define clags_required_custom(val, n, desc, vfunc) (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Custom,.value_func=(vfunc),.is_list=false}}
-#define clags_required_bool(val, n, desc)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Bool,.value_func=NULL,.is_list=false}}
-#define clags_required_int8(val, n, desc)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int8,.value_func=NULL,.is_list=false}}
-#define clags_required_uint8(val, n, desc)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt8,.value_func=NULL,.is_list=false}}
-#define clags_required_int32(val, n, desc)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int32,.value_func=NULL,.is_list=false}}
-#define clags_required_uint32(val, n, desc)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt32,.value_func=NULL,.is_list=false}}
-#define clags_required_double(val, n, desc)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Double,.value_func=NULL,.is_list=false}}
-
-#define clags_required_list(val, n, desc)               (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_None,.value_func=NULL,.is_list=true}}
-#define clags_required_custom_list(val, n, desc, vfunc) (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Custom,.value_func=(vfunc),.is_list=true}}
-#define clags_required_bool_list(val, n, desc)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Bool,.value_func=NULL,.is_list=true}}
-#define clags_required_int8_list(val, n, desc)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int8,.value_func=NULL,.is_list=true}}
-#define clags_required_uint8_list(val, n, desc)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt8,.value_func=NULL,.is_list=true}}
-#define clags_required_int32_list(val, n, desc)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int32,.value_func=NULL,.is_list=true}}
-#define clags_required_uint32_list(val, n, desc)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt32,.value_func=NULL,.is_list=true}}
-#define clags_required_double_list(val, n, desc)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Double,.value_func=NULL,.is_list=true}}
-
-#define clags_optional(sf, lf, val, f_name, desc)               (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_None,.value_func=NULL}}
-#define clags_optional_custom(sf, lf, val, f_name, desc, vfunc) (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Custom,.value_func=(vfunc)}}
-#define clags_optional_bool(sf, lf, val, f_name, desc)          (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Bool,.value_func=NULL}}
-#define clags_optional_int8(sf, lf, val, f_name, desc)          (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Int8,.value_func=NULL}}
-#define clags_optional_uint8(sf, lf, val, f_name, desc)         (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_UInt8,.value_func=NULL}}
-#define clags_optional_int32(sf, lf, val, f_name, desc)         (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Int32,.value_func=NULL}}
-#define clags_optional_uint32(sf, lf, val, f_name, desc)        (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_UInt32,.value_func=NULL}}
-#define clags_optional_double(sf, lf, val, f_name, desc)        (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Double,.value_func=NULL}}
-
-#define clags_flag(sf, lf, val, desc, ex) (clags_arg_t) {.type=Clags_Flag, .flag=(clags_flag_t){.short_flag=(sf), .long_flag=(lf), .value=(val), .description=(desc), .exit=(ex)}}
+#define clags_required(val, n, desc, ...)               (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_None,.value_func=NULL,.is_list=false,__VA_ARGS__}}
+#define clags_required_custom(val, n, desc, vfunc, ...) (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Custom,.value_func=(vfunc),.is_list=false,__VA_ARGS__}}
+#define clags_required_bool(val, n, desc, ...)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Bool,.value_func=NULL,.is_list=false,__VA_ARGS__}}
+#define clags_required_int8(val, n, desc, ...)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int8,.value_func=NULL,.is_list=false,__VA_ARGS__}}
+#define clags_required_uint8(val, n, desc, ...)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt8,.value_func=NULL,.is_list=false,__VA_ARGS__}}
+#define clags_required_int32(val, n, desc, ...)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int32,.value_func=NULL,.is_list=false,__VA_ARGS__}}
+#define clags_required_uint32(val, n, desc, ...)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt32,.value_func=NULL,.is_list=false,__VA_ARGS__}}
+#define clags_required_double(val, n, desc, ...)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Double,.value_func=NULL,.is_list=false,__VA_ARGS__}}
+
+#define clags_required_list(val, n, desc, ...)               (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_None,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_required_custom_list(val, n, desc, vfunc, ...) (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Custom,.value_func=(vfunc),.is_list=true,__VA_ARGS__}}
+#define clags_required_bool_list(val, n, desc, ...)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Bool,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_required_int8_list(val, n, desc, ...)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int8,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_required_uint8_list(val, n, desc, ...)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt8,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_required_int32_list(val, n, desc, ...)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int32,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_required_uint32_list(val, n, desc, ...)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt32,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_required_double_list(val, n, desc, ...)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Double,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+
+#define clags_required_stream(val, n, desc, ...)               (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_None,.value_func=NULL,.is_list=true,.is_stream=true,__VA_ARGS__}}
+#define clags_required_custom_stream(val, n, desc, vfunc, ...) (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Custom,.value_func=(vfunc),.is_list=true,.is_stream=true,__VA_ARGS__}}
+#define clags_required_bool_stream(val, n, desc, ...)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Bool,.value_func=NULL,.is_list=true,.is_stream=true,__VA_ARGS__}}
+#define clags_required_int8_stream(val, n, desc, ...)          (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int8,.value_func=NULL,.is_list=true,.is_stream=true,__VA_ARGS__}}
+#define clags_required_uint8_stream(val, n, desc, ...)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt8,.value_func=NULL,.is_list=true,.is_stream=true,__VA_ARGS__}}
+#define clags_required_int32_stream(val, n, desc, ...)         (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Int32,.value_func=NULL,.is_list=true,.is_stream=true,__VA_ARGS__}}
+#define clags_required_uint32_stream(val, n, desc, ...)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_UInt32,.value_func=NULL,.is_list=true,.is_stream=true,__VA_ARGS__}}
+#define clags_required_double_stream(val, n, desc, ...)        (clags_arg_t){.type=Clags_Required,.req=(clags_req_t){.name=(n),.value=(val),.description=(desc),.value_type=Clags_Double,.value_func=NULL,.is_list=true,.is_stream=true,__VA_ARGS__}}
+
+#define clags_optional(sf, lf, val, f_name, desc, ...)               (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_None,.value_func=NULL,__VA_ARGS__}}
+#define clags_optional_custom(sf, lf, val, f_name, desc, vfunc, ...) (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Custom,.value_func=(vfunc),__VA_ARGS__}}
+#define clags_optional_bool(sf, lf, val, f_name, desc, ...)          (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Bool,.value_func=NULL,__VA_ARGS__}}
+#define clags_optional_int8(sf, lf, val, f_name, desc, ...)          (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Int8,.value_func=NULL,__VA_ARGS__}}
+#define clags_optional_uint8(sf, lf, val, f_name, desc, ...)         (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_UInt8,.value_func=NULL,__VA_ARGS__}}
+#define clags_optional_int32(sf, lf, val, f_name, desc, ...)         (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Int32,.value_func=NULL,__VA_ARGS__}}
+#define clags_optional_uint32(sf, lf, val, f_name, desc, ...)        (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_UInt32,.value_func=NULL,__VA_ARGS__}}
+#define clags_optional_double(sf, lf, val, f_name, desc, ...)        (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Double,.value_func=NULL,__VA_ARGS__}}
+
+// list options split their value on a separator, which defaults to CLAGS_LIST_SEPARATOR and can be set with a trailing .separator=':'
+#define clags_optional_list(sf, lf, val, f_name, desc, ...)               (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_None,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_optional_custom_list(sf, lf, val, f_name, desc, vfunc, ...) (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Custom,.value_func=(vfunc),.is_list=true,__VA_ARGS__}}
+#define clags_optional_bool_list(sf, lf, val, f_name, desc, ...)          (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Bool,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_optional_int8_list(sf, lf, val, f_name, desc, ...)          (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Int8,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_optional_uint8_list(sf, lf, val, f_name, desc, ...)         (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_UInt8,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_optional_int32_list(sf, lf, val, f_name, desc, ...)         (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Int32,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_optional_uint32_list(sf, lf, val, f_name, desc, ...)        (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_UInt32,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+#define clags_optional_double_list(sf, lf, val, f_name, desc, ...)        (clags_arg_t){.type=Clags_Optional,.opt=(clags_opt_t){.short_flag=(sf),.long_flag=(lf),.value=(val),.description=(desc),.field_name=(f_name),.value_type=Clags_Double,.value_func=NULL,.is_list=true,__VA_ARGS__}}
+
+#ifndef CLAGS_LIST_SEPARATOR
+#define CLAGS_LIST_SEPARATOR ','
+#endif
+
+#define clags_flag(sf, lf, val, desc, ex, ...) (clags_arg_t) {.type=Clags_Flag, .flag=(clags_flag_t){.short_flag=(sf), .long_flag=(lf), .value=(val), .description=(desc), .exit=(ex), __VA_ARGS__}}
 #define clags_flag_help(val) clags_flag("-h", "--help", val, "print this help dialog", true)
 
+#define clags_command(n, val, sub_args, desc) (clags_arg_t) {.type=Clags_Command, .cmd=(clags_cmd_t){.name=(n), .value=(val), .args=(sub_args), .arg_count=clags_arr_len(sub_args), .description=(desc)}}
+
 #define clags_list              (clags_list_t) {.items=NULL, .count=0, .capacity=0, .item_size=sizeof(char*)}
 #define clags_custom_list(size) (clags_list_t) {.items=NULL, .count=0, .capacity=0, .item_size=(size)}
 #define clags_bool_list         (clags_list_t) {.items=NULL, .count=0, .capacity=0, .item_size=sizeof(bool)}
@@ -164,6 +471,22 @@ typedef struct{
 #define clags_uint32_list       (clags_list_t) {.items=NULL, .count=0, .capacity=0, .item_size=sizeof(uint32_t)}
 #define clags_double_list       (clags_list_t) {.items=NULL, .count=0, .capacity=0, .item_size=sizeof(double)}
 
+#define clags_stream(f, c)              (clags_stream_t) {.func=(f), .ctx=(c), .item_size=sizeof(char*)}
+#define clags_custom_stream(size, f, c) (clags_stream_t) {.func=(f), .ctx=(c), .item_size=(size)}
+#define clags_bool_stream(f, c)         (clags_stream_t) {.func=(f), .ctx=(c), .item_size=sizeof(bool)}
+#define clags_int8_stream(f, c)         (clags_stream_t) {.func=(f), .ctx=(c), .item_size=sizeof(int8_t)}
+#define clags_uint8_stream(f, c)        (clags_stream_t) {.func=(f), .ctx=(c), .item_size=sizeof(uint8_t)}
+#define clags_int32_stream(f, c)        (clags_stream_t) {.func=(f), .ctx=(c), .item_size=sizeof(int32_t)}
+#define clags_uint32_stream(f, c)       (clags_stream_t) {.func=(f), .ctx=(c), .item_size=sizeof(uint32_t)}
+#define clags_double_stream(f, c)       (clags_stream_t) {.func=(f), .ctx=(c), .item_size=sizeof(double)}
+
+#ifndef CLAGS_STREAM_CHUNK_SIZE
+#define CLAGS_STREAM_CHUNK_SIZE (64*1024)
+#endif
+
+// a list of any type backed by a caller-provided array that is never reallocated
+#define clags_fixed_list(array) (clags_list_t) {.items=(array), .count=0, .capacity=clags_arr_len(array), .item_size=sizeof((array)[0]), .fixed=true}
+
 #define clags_arr_len(arr) (sizeof(arr)/sizeof(arr[0]))
 
 #define clags_parse(argc, argv, args) clags__parse((argc), (argv), (args), clags_arr_len(args))
@@ -172,11 +495,92 @@ bool clags__parse(int argc, char **argv, clags_arg_t *args, size_t arg_count);
 #define clags_usage(pn, args) clags__usage((pn), (args), clags_arr_len(args))
 void clags__usage(const char *program_name, clags_arg_t *args, size_t arg_count);
 
+#define clags_usage_command(pn, args, command) clags__usage_command((pn), (args), clags_arr_len(args), (command))
+void clags__usage_command(const char *program_name, clags_arg_t *args, size_t arg_count, const char *command);
+
+#define clags_compile(spec, args) clags__compile((spec), (args), clags_arr_len(args), NULL)
+#define clags_compile_with(spec, args, allocator) clags__compile((spec), (args), clags_arr_len(args), (allocator))
+bool clags__compile(clags_spec_t *spec, clags_arg_t *args, size_t arg_count, const clags_allocator_t *allocator);
+#define clags_compile_lookup(spec, args, lookup) clags__compile_lookup((spec), (args), clags_arr_len(args), (lookup), NULL)
+bool clags__compile_lookup(clags_spec_t *spec, clags_arg_t *args, size_t arg_count, clags_lookup_func_t lookup, const clags_allocator_t *allocator);
+bool clags_parse_spec(int argc, char **argv, clags_spec_t *spec);
+bool clags_parse_with(int argc, char **argv, clags_spec_t *spec, const clags_settings_t *settings);
+bool clags_parse_line(clags_spec_t *spec, char *line, const clags_settings_t *settings);
+bool clags_reconfigure(int argc, char **argv, clags_spec_t *spec, const clags_settings_t *settings);
+void clags_usage_spec(const char *program_name, clags_spec_t *spec);
+bool clags_usage_output(const char *program_name, clags_spec_t *spec, clags_output_t *output);
+void clags_usage_command_spec(const char *program_name, clags_spec_t *spec, const char *command);
+bool clags_usage_command_output(const char *program_name, clags_spec_t *spec, const char *command, clags_output_t *output);
+void clags_spec_free(clags_spec_t *spec);
+
+#define CLAGS_SNAPSHOT_VERSION 1
+bool clags_snapshot_save(clags_spec_t *spec, clags_output_t *output, clags_error_t *error);
+bool clags_snapshot_load(clags_spec_t *spec, const void *data, size_t size, const clags_settings_t *settings);
+bool clags_snapshot_load_file(clags_spec_t *spec, const char *path, const clags_settings_t *settings);
+
+#define clags_lazy_get(type, lazy, error) ((type*) clags_lazy_value((lazy), (error)))
+void *clags_lazy_value(clags_lazy_t *lazy, clags_error_t *error);
+bool clags_force_all(clags_spec_t *spec, clags_error_t *error);
+
 void clags_list_free(clags_list_t *list);
 
+void clags_arena_init(clags_arena_t *arena, void *buffer, size_t size);
+clags_allocator_t clags_arena_allocator(clags_arena_t *arena);
+void clags_arena_free(clags_arena_t *arena);
+
+void clags_files_free(clags_files_t *files);
+
+bool clags_config_load(clags_config_t *config, const char *path, const clags_allocator_t *allocator);
+const char *clags_config_get(const clags_config_t *config, const char *key);
+void clags_config_free(clags_config_t *config);
+
+#define clags_complete(argc, argv, args) clags__complete((argc), (argv), (args), clags_arr_len(args))
+bool clags__complete(int argc, char **argv, clags_arg_t *args, size_t arg_count);
+bool clags_complete_spec(int argc, char **argv, clags_spec_t *spec);
+bool clags_complete_output(int argc, char **argv, clags_spec_t *spec, clags_output_t *output);
+void clags_complete_add(clags_completion_t *completion, const char *candidate, const char *description);
+
+bool clags_parse_batch(clags_spec_t *spec, size_t count, const int *argcs, char ***argvs, clags_error_t *errors, const clags_settings_t *settings);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // CLAGS_H
 
-#ifdef CLAGS_IMPLEMENTATION
+#if defined(CLAGS_IMPLEMENTATION) && !defined(CLAGS__IMPLEMENTED)
+#define CLAGS__IMPLEMENTED
+
+#include <stdarg.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CLAGS__POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef CLAGS_NO_THREADS
+#define CLAGS__THREADS
+#include <pthread.h>
+#endif
+#endif
+
+#ifdef CLAGS_STATS
+#include <time.h>
+#define CLAGS__STAT_ADD(state, field, n) do{ if ((state)->stats) (state)->stats->field += (n); } while(0)
+#else
+#define CLAGS__STAT_ADD(state, field, n) ((void)0)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+// designated initializers leave the remaining fields zeroed, as in C
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+#endif
 
 #define X(type, func, name) [type] = func,
 static clags_value_verify_t clags__verify_funcs[] = {
@@ -190,15 +594,32 @@ static const char *clags__type_names[] = {
 };
 #undef X
 
-bool clags__verify_none(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+// records an error in the caller's error struct, or prints it to stderr when there is none
+void clags__report(clags_error_t *error, clags_error_code_t code, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    if (error){
+        error->code = code;
+        vsnprintf(error->message, sizeof(error->message), fmt, args);
+    } else{
+        fprintf(stderr, "[ERROR] ");
+        vfprintf(stderr, fmt, args);
+        fprintf(stderr, "\n");
+    }
+    va_end(args);
+}
+
+bool clags__verify_none(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error)
 {
     (void)func;
     (void) arg_name;
+    (void) error;
     if (pvalue) *(char**)pvalue = (char*)arg;
     return true;
 }
 
-bool clags__verify_bool(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+bool clags__verify_bool(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error)
 {
     (void)func;
     if (strcmp(arg, "true") == 0) {
@@ -208,104 +629,231 @@ bool clags__verify_bool(const char *arg_name, const char *arg, void *pvalue, cla
         if (pvalue) *(bool*)pvalue = false;
         return true;
     }
-    fprintf(stderr, "[ERROR] Invalid boolean value for argument '%s': '%s'!\n", arg_name, arg);
+    clags__report(error, Clags_Error_InvalidValue, "Invalid boolean value for argument '%s': '%s'!", arg_name, arg);
     return false;
 }
 
 
-bool clags__verify_int8(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+#define CLAGS__ONES(byte) (0x0101010101010101ull*(byte))
+
+// true when all eight bytes of a little or big endian word are ASCII digits
+static inline bool clags__swar_is_digits(uint64_t v)
+{
+    return ((v & CLAGS__ONES(0xF0)) | (((v + CLAGS__ONES(0x06)) & CLAGS__ONES(0xF0)) >> 4)) == CLAGS__ONES(0x33);
+}
+
+// converts eight ASCII digits loaded in memory order into their value
+static inline uint32_t clags__swar_eight_digits(const char *digits)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint32_t result = 0;
+    for (size_t i=0; i<8; ++i) result = result*10 + (uint32_t)(digits[i]-'0');
+    return result;
+#else
+    uint64_t v;
+    memcpy(&v, digits, sizeof(v));
+    v -= CLAGS__ONES('0');
+    v = (v*10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFull) * 0x000F424000000064ull) + (((v >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+    return (uint32_t) v;
+#endif
+}
+
+// accepts exactly what strtol/strtoul accept in the C locale, i.e. [space][+|-]digits or the empty string;
+// magnitudes above 32 bits only set overflow, as no supported type can hold them
+bool clags__scan_integer(const char *arg, bool *negative, uint64_t *magnitude, bool *overflow)
+{
+    const char *p = arg;
+    while (*p == ' ' || (*p >= '\t' && *p <= '\r')) p++;
+    *negative = *p == '-';
+    p += *p == '-' || *p == '+';
+    *magnitude = 0;
+    *overflow = false;
+
+    size_t length = strlen(p);
+    if (length == 0) return *arg == '\0';
+    size_t i = 0;
+    for (; i+8 <= length; i += 8){
+        uint64_t v;
+        memcpy(&v, p+i, sizeof(v));
+        if (!clags__swar_is_digits(v)) return false;
+    }
+    for (; i<length; ++i){
+        if ((unsigned char)(p[i]-'0') > 9) return false;
+    }
+
+    while (length > 1 && *p == '0'){
+        p++;
+        length--;
+    }
+    if (length > 10){
+        *overflow = true;
+        return true;
+    }
+    uint64_t value = 0;
+    i = 0;
+    if (length >= 8){
+        value = clags__swar_eight_digits(p);
+        i = 8;
+    }
+    for (; i<length; ++i) value = value*10 + (uint64_t)(p[i]-'0');
+    *magnitude = value;
+    return true;
+}
+
+bool clags__verify_int8(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error)
 {
     (void)func;
-    char *endptr;
-    errno = 0;
-    long value = strtol(arg, &endptr, 10);
+    bool negative, overflow;
+    uint64_t magnitude;
 
-    if (*endptr != '\0') {
-        fprintf(stderr, "[ERROR] Invalid int8 value for argument '%s': '%s'!\n", arg_name, arg);
+    if (!clags__scan_integer(arg, &negative, &magnitude, &overflow)) {
+        clags__report(error, Clags_Error_InvalidValue, "Invalid int8 value for argument '%s': '%s'!", arg_name, arg);
         return false;
     }
-    if (errno == ERANGE || value < INT8_MIN || value > INT8_MAX) {
-        fprintf(stderr, "[ERROR] int8 value out of range (%d to %d) for argument '%s': '%s'!\n", INT8_MIN, INT8_MAX, arg_name, arg);
+    if (overflow || magnitude > (negative? (uint64_t)INT8_MAX+1:(uint64_t)INT8_MAX)) {
+        clags__report(error, Clags_Error_OutOfRange, "int8 value out of range (%d to %d) for argument '%s': '%s'!", INT8_MIN, INT8_MAX, arg_name, arg);
         return false;
     }
 
-    if (pvalue) *(int8_t*)pvalue = (int8_t)value;
+    if (pvalue) *(int8_t*)pvalue = (int8_t)(negative? -(int64_t)magnitude:(int64_t)magnitude);
     return true;
 }
 
-bool clags__verify_uint8(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+bool clags__verify_uint8(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error)
 {
     (void)func;
-    char *endptr;
-    errno = 0;
-    unsigned long value = strtoul(arg, &endptr, 10);
+    bool negative, overflow;
+    uint64_t magnitude;
 
-    if (*endptr != '\0') {
-        fprintf(stderr, "[ERROR] Invalid uint8 value for argument '%s': '%s'!\n", arg_name, arg);
+    if (!clags__scan_integer(arg, &negative, &magnitude, &overflow)) {
+        clags__report(error, Clags_Error_InvalidValue, "Invalid uint8 value for argument '%s': '%s'!", arg_name, arg);
         return false;
     }
-    if (errno == ERANGE || value > UINT8_MAX) {
-        fprintf(stderr, "[ERROR] uint8 value out of range (0 to %u) for argument '%s': '%s'!\n", UINT8_MAX, arg_name, arg);
+    // like strtoul, "-0" is zero and any other negative value wraps out of range
+    if (overflow || (negative && magnitude != 0) || magnitude > UINT8_MAX) {
+        clags__report(error, Clags_Error_OutOfRange, "uint8 value out of range (0 to %u) for argument '%s': '%s'!", UINT8_MAX, arg_name, arg);
         return false;
     }
 
-    if (pvalue) *(uint8_t*)pvalue = (uint8_t)value;
+    if (pvalue) *(uint8_t*)pvalue = (uint8_t)magnitude;
     return true;
 }
 
-bool clags__verify_int32(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+bool clags__verify_int32(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error)
 {
     (void)func;
-    char *endptr;
-    errno = 0;
-    long value = strtol(arg, &endptr, 10);
+    bool negative, overflow;
+    uint64_t magnitude;
 
-    if (*endptr != '\0') {
-        fprintf(stderr, "[ERROR] Invalid int32 value for argument '%s': '%s'!\n", arg_name, arg);
+    if (!clags__scan_integer(arg, &negative, &magnitude, &overflow)) {
+        clags__report(error, Clags_Error_InvalidValue, "Invalid int32 value for argument '%s': '%s'!", arg_name, arg);
         return false;
     }
-    if (errno == ERANGE || value < INT32_MIN || value > INT32_MAX) {
-        fprintf(stderr, "[ERROR] int32 value out of range (%d to %d) for argument '%s': '%s'!\n", INT32_MIN, INT32_MAX, arg_name, arg);
+    if (overflow || magnitude > (negative? (uint64_t)INT32_MAX+1:(uint64_t)INT32_MAX)) {
+        clags__report(error, Clags_Error_OutOfRange, "int32 value out of range (%d to %d) for argument '%s': '%s'!", INT32_MIN, INT32_MAX, arg_name, arg);
         return false;
     }
 
-    if (pvalue) *(int32_t*)pvalue = (int32_t)value;
+    if (pvalue) *(int32_t*)pvalue = (int32_t)(negative? -(int64_t)magnitude:(int64_t)magnitude);
     return true;
 }
 
-bool clags__verify_uint32(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+bool clags__verify_uint32(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error)
 {
     (void)func;
-    char *endptr;
-    errno = 0;
-    unsigned long value = strtoul(arg, &endptr, 10);
+    bool negative, overflow;
+    uint64_t magnitude;
 
-    if (*endptr != '\0') {
-        fprintf(stderr, "[ERROR] Invalid uint32 value for argument '%s': '%s'!\n", arg_name, arg);
+    if (!clags__scan_integer(arg, &negative, &magnitude, &overflow)) {
+        clags__report(error, Clags_Error_InvalidValue, "Invalid uint32 value for argument '%s': '%s'!", arg_name, arg);
         return false;
     }
-    if (errno == ERANGE || value > UINT32_MAX) {
-        fprintf(stderr, "[ERROR] uint32 value out of range (0 to %u) for argument '%s': '%s'!\n", UINT32_MAX, arg_name, arg);
+    if (overflow || (negative && magnitude != 0) || magnitude > UINT32_MAX) {
+        clags__report(error, Clags_Error_OutOfRange, "uint32 value out of range (0 to %u) for argument '%s': '%s'!", UINT32_MAX, arg_name, arg);
         return false;
     }
 
-    if (pvalue) *(uint32_t*)pvalue = (uint32_t)value;
+    if (pvalue) *(uint32_t*)pvalue = (uint32_t)magnitude;
+    return true;
+}
+
+// Clinger's fast path: a decimal with at most 2^53 as mantissa and a power of ten up to 1e22 is
+// exactly representable on both sides, so a single IEEE multiplication or division rounds correctly.
+// Everything else (long mantissas, large exponents, hex, inf, nan, invalid input) is left to strtod.
+bool clags__fast_double(const char *arg, double *value)
+{
+#if FLT_EVAL_METHOD == 0
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char *p = arg;
+    while (*p == ' ' || (*p >= '\t' && *p <= '\r')) p++;
+    bool negative = *p == '-';
+    p += *p == '-' || *p == '+';
+
+    uint64_t mantissa = 0;
+    size_t digits = 0, significant = 0;
+    int64_t exponent = 0;
+    for (; (unsigned char)(*p-'0') <= 9; ++p, ++digits){
+        if (mantissa == 0 && *p == '0') continue;
+        if (++significant > 19) return false;
+        mantissa = mantissa*10 + (uint64_t)(*p-'0');
+    }
+    if (*p == '.'){
+        for (++p; (unsigned char)(*p-'0') <= 9; ++p, ++digits){
+            exponent--;
+            if (mantissa == 0 && *p == '0') continue;
+            if (++significant > 19) return false;
+            mantissa = mantissa*10 + (uint64_t)(*p-'0');
+        }
+    }
+    if (digits == 0) return false;
+    if (*p == 'e' || *p == 'E'){
+        ++p;
+        bool negative_exponent = *p == '-';
+        p += *p == '-' || *p == '+';
+        if ((unsigned char)(*p-'0') > 9) return false;
+        int64_t e = 0;
+        for (; (unsigned char)(*p-'0') <= 9; ++p){
+            if (e < 100000) e = e*10 + (*p-'0');
+        }
+        exponent += negative_exponent? -e:e;
+    }
+    if (*p != '\0') return false;
+    if (mantissa > (1ull << 53) || exponent < -22 || exponent > 22) return false;
+
+    double result = (double) mantissa;
+    result = exponent < 0? result/powers[-exponent]:result*powers[exponent];
+    *value = negative? -result:result;
     return true;
+#else
+    (void) arg;
+    (void) value;
+    return false;
+#endif
 }
 
-bool clags__verify_double(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+bool clags__verify_double(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error)
 {
     (void)func;
+    double value;
+    if (clags__fast_double(arg, &value)){
+        if (pvalue) *(double*)pvalue = value;
+        return true;
+    }
+
     char *endptr;
     errno = 0;
-    double value = strtod(arg, &endptr);
+    value = strtod(arg, &endptr);
 
     if (*endptr != '\0') {
-        fprintf(stderr, "[ERROR] Invalid double value for argument '%s': '%s'!\n", arg_name, arg);
+        clags__report(error, Clags_Error_InvalidValue, "Invalid double value for argument '%s': '%s'!", arg_name, arg);
         return false;
     }
     if (errno == ERANGE || value > DBL_MAX || value < -DBL_MAX) {
-        fprintf(stderr, "[ERROR] double value out of range for argument '%s': '%s'!\n", arg_name, arg);
+        clags__report(error, Clags_Error_OutOfRange, "double value out of range for argument '%s': '%s'!", arg_name, arg);
         return false;
     }
 
@@ -313,235 +861,2758 @@ bool clags__verify_double(const char *arg_name, const char *arg, void *pvalue, c
     return true;
 }
 
-bool clags__verify_custom(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+void clags__report_rejected(clags_error_t *error, const char *arg_name, const char *arg)
+{
+    clags__report(error, Clags_Error_Rejected, "Value for argument '%s' does not match custom criteria: '%s'!", arg_name, arg);
+}
+
+bool clags__verify_custom(const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func, clags_error_t *error)
 {
     if (!func(arg_name, (char*)arg, pvalue)) {
-        fprintf(stderr, "[ERROR] Value for argument '%s' does not match custom criteria: '%s'!\n", arg_name, arg);
+        clags__report_rejected(error, arg_name, arg);
         return false;
     }
     return true;
 }
 
-bool clags__append_to_list(clags_req_t req, const char *arg)
+// allocators are kept by value, as the caller's variable may be gone by the time the memory is released;
+// a kept allocator without an alloc function stands for the heap
+clags_allocator_t clags__keep_allocator(const clags_allocator_t *allocator)
 {
-    clags_list_t *list = (clags_list_t*) req.value;
-    size_t item_size = list->item_size;
-    if (list->count >= list->capacity){
-        size_t new_capacity = list->capacity==0? 8:list->capacity*2;
-        list->items = realloc(list->items, new_capacity*item_size);
-        list->capacity = new_capacity;
-        assert(list->items && "Buy more RAM lol");
+    clags_allocator_t heap = {NULL, NULL, NULL, NULL};
+    return allocator? *allocator:heap;
+}
+
+void *clags__alloc(const clags_allocator_t *allocator, size_t size)
+{
+    if (allocator && allocator->alloc) return allocator->alloc(allocator->ctx, size);
+#ifndef CLAGS_NO_MALLOC
+    return malloc(size);
+#else
+    return NULL;
+#endif
+}
+
+void *clags__realloc(const clags_allocator_t *allocator, void *ptr, size_t old_size, size_t new_size)
+{
+    if (allocator && allocator->alloc) return allocator->realloc(allocator->ctx, ptr, old_size, new_size);
+#ifndef CLAGS_NO_MALLOC
+    (void) old_size;
+    return realloc(ptr, new_size);
+#else
+    (void) ptr; (void) old_size; (void) new_size;
+    return NULL;
+#endif
+}
+
+void clags__free(const clags_allocator_t *allocator, void *ptr, size_t size)
+{
+    if (allocator && allocator->alloc){
+        if (allocator->free) allocator->free(allocator->ctx, ptr, size);
+        return;
     }
-    char *ptr = (char*) list->items;
-    return clags__verify_funcs[req.value_type](req.name, arg, ptr+item_size*list->count++, req.value_func);
+#ifndef CLAGS_NO_MALLOC
+    (void) size;
+    free(ptr);
+#else
+    (void) ptr; (void) size;
+#endif
 }
 
-void clags__sort_args(clags_args_t *args, clags_arg_t *_args, size_t arg_count)
+// max_align_t only exists from C11 on
+typedef union{
+    long double ld;
+    long long ll;
+    void *p;
+    void (*f)(void);
+} clags__align_t;
+
+struct clags__arena_block_t{
+    clags__arena_block_t *next;
+    size_t capacity;
+    size_t used;
+};
+
+#define CLAGS__ARENA_ALIGN(size) (((size) + sizeof(clags__align_t)-1) & ~(sizeof(clags__align_t)-1))
+#ifndef CLAGS_ARENA_BLOCK_SIZE
+#define CLAGS_ARENA_BLOCK_SIZE (64*1024)
+#endif
+
+void clags_arena_init(clags_arena_t *arena, void *buffer, size_t size)
 {
-    for (size_t i=0; i<arg_count; ++i){
-        switch(_args[i].type){
-            case Clags_Required:{
-                args->required[args->required_count++] = _args[i].req;
-            } break;
-            case Clags_Optional:{
-                args->optional[args->optional_count++] = _args[i].opt;
-            } break;
-            case Clags_Flag:{
-                args->flags[args->flag_count++] = _args[i].flag;
-            } break;
-            default: {
-                assert(0 && "Unreachable");
-            }
+    *arena = (clags_arena_t){.buffer=(char*)buffer, .capacity=buffer? size:0};
+}
+
+void *clags__arena_alloc(void *ctx, size_t size)
+{
+    clags_arena_t *arena = (clags_arena_t*) ctx;
+    size = CLAGS__ARENA_ALIGN(size);
+    if (arena->buffer){
+        if (size > arena->capacity - arena->used) return NULL;
+        arena->last = arena->buffer + arena->used;
+        arena->used += size;
+        return arena->last;
+    }
+#ifndef CLAGS_NO_MALLOC
+    clags__arena_block_t *block = arena->blocks;
+    if (block == NULL || size > block->capacity - block->used){
+        size_t capacity = size > CLAGS_ARENA_BLOCK_SIZE? size:CLAGS_ARENA_BLOCK_SIZE;
+        block = (clags__arena_block_t*) malloc(CLAGS__ARENA_ALIGN(sizeof(*block)) + capacity);
+        if (block == NULL) return NULL;
+        *block = (clags__arena_block_t){.next=arena->blocks, .capacity=capacity};
+        arena->blocks = block;
+    }
+    arena->last = (char*) block + CLAGS__ARENA_ALIGN(sizeof(*block)) + block->used;
+    block->used += size;
+    return arena->last;
+#else
+    return NULL;
+#endif
+}
+
+void *clags__arena_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+    clags_arena_t *arena = (clags_arena_t*) ctx;
+    old_size = CLAGS__ARENA_ALIGN(old_size);
+    // the most recent allocation can grow in place
+    if (ptr != NULL && ptr == arena->last){
+        size_t *used = arena->buffer? &arena->used:&arena->blocks->used;
+        size_t capacity = arena->buffer? arena->capacity:arena->blocks->capacity;
+        if (CLAGS__ARENA_ALIGN(new_size) <= capacity - (*used - old_size)){
+            *used += CLAGS__ARENA_ALIGN(new_size) - old_size;
+            return ptr;
         }
     }
+    void *result = clags__arena_alloc(ctx, new_size);
+    if (result && ptr) memcpy(result, ptr, old_size < new_size? old_size:new_size);
+    return result;
 }
 
-bool clags__parse(int argc, char **argv, clags_arg_t *_args, size_t arg_count)
+clags_allocator_t clags_arena_allocator(clags_arena_t *arena)
 {
-    clags_req_t required[arg_count];
-    clags_opt_t optional[arg_count];
-    clags_flag_t flags[arg_count];
-    bool in_list = false;
+    return (clags_allocator_t){.alloc=clags__arena_alloc, .realloc=clags__arena_realloc, .free=NULL, .ctx=arena};
+}
 
-    clags_args_t args = {.required=required, .optional=optional, .flags=flags};
-    
-    clags__sort_args(&args, _args, arg_count);
-    
-    size_t required_found = 0;
-    for (size_t index=1; index<(size_t)argc; ++index){
-        char *arg = argv[index];
-        if (strcmp(arg, "--") == 0){
-            if (in_list){
-                in_list = false;
-                required_found++;
-            }
-            continue;
-        }
-        for (size_t i=0; i<args.optional_count; ++i){
-            clags_opt_t opt = args.optional[i];
-            if ((opt.short_flag != NULL && strcmp(arg, opt.short_flag) == 0) || (opt.long_flag != NULL && strcmp(arg, opt.long_flag) == 0)){
-                if (argc-index <= 1){
-                    fprintf(stderr, "[ERROR] Optional flag %s requires argument!\n", arg);
-                    return false;
-                }
-                char *result = argv[++index];
-                if (!clags__verify_funcs[opt.value_type](arg, result, opt.value, opt.value_func)) return false;
-                goto next_arg;
-            } else if (opt.long_flag != NULL && strncmp(arg, opt.long_flag, strlen(opt.long_flag)) == 0){
-                char *value = arg+strlen(opt.long_flag);
-                if (*value++ == '='){
-                    if (*value == '\0'){
-                        fprintf(stderr, "[ERROR] Designated option assignment may not have an empty value: '%s'!\n", arg);
-                        return false;
-                    }
-                    if (!clags__verify_funcs[opt.value_type](opt.long_flag, value, opt.value, opt.value_func)) return false;
-                    goto next_arg;
-                }
-            }
-        }
-        
-        for (size_t i=0; i<args.flag_count; ++i){
-            clags_flag_t flag = args.flags[i];
-            if ((flag.short_flag != NULL && strcmp(arg, flag.short_flag) == 0) || (flag.long_flag != NULL && strcmp(arg, flag.long_flag) == 0)){
-                if (flag.value != NULL) *flag.value = true;
-                if (flag.exit) return true;
-                goto next_arg;
-            }
-        }
-        if (arg[0] == '-' && arg[1] != '-' && strlen(arg) > 2) { 
-            for (size_t c = 1; c < strlen(arg); ++c) {
-                char short_flag_str[3] = { '-', arg[c], '\0' };
-                bool matched = false;
-                for (size_t i = 0; i < args.flag_count; ++i) {
-                    clags_flag_t flag = args.flags[i];
-                    if (flag.short_flag && (strcmp(flag.short_flag, short_flag_str) == 0 || (*flag.short_flag!='-' && strcmp(flag.short_flag, short_flag_str+1) == 0))) {
-                        if (flag.value) *flag.value = true;
-                        if (flag.exit) return true;
-                        matched = true;
-                        break;
-                    }
-                }
-                if (!matched) {
-                    fprintf(stderr, "[ERROR] Unknown short flag in combination: '-%c'\n", arg[c]);
-                    return false;
-                }
-            }
-            goto next_arg;
-        }
+void clags_arena_free(clags_arena_t *arena)
+{
+#ifndef CLAGS_NO_MALLOC
+    while (arena->blocks){
+        clags__arena_block_t *next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+#endif
+    arena->used = 0;
+    arena->last = NULL;
+}
 
-        if (*arg == '-'){
-            fprintf(stderr, "[ERROR] Unknown option: '%s'!\n", arg);
-            return false;
-        }
+typedef struct clags__state_t{
+    clags_spec_t *spec;
+    const clags_allocator_t *allocator;
+    clags_files_t *files;
+    bool response_files;
+    clags_arg_t *pending;
+    const char *pending_flag;
+    size_t required_found;
+    bool in_list;
+    bool exit;
+    clags_stats_t *stats;
+    clags_trace_func_t trace;
+    void *trace_ctx;
+    size_t token_index;
+    clags_error_t *error;
+    bool validate_only;
+    bool (*feed)(struct clags__state_t *state, char *arg);  // replaces clags__feed in generated parsers
+    const clags_config_t *config;
+    bool env;
+    bool *seen;  // options given on the command line or by env, only tracked when the spec has fallbacks
+    clags_spec_t *parent;  // the spec holding the global options once a command was selected
+    bool *parent_seen;
+    clags_arg_t *command;
+    void *command_memory;  // holds the table of the selected command, a CLAGS_COMMAND_BUFFER_SIZE buffer on the stack until then
+    size_t command_size;   // the size of command_memory if it came from the allocator, else 0
+    size_t threads;
+    char *line;  // split into tokens in place instead of reading argv, see clags_parse_line
+    size_t response_bytes;
+    size_t response_count;
+} clags__state_t;
 
-        if (required_found >= args.required_count){
-            fprintf(stderr, "[ERROR] Unknown additional argument (%zu/%zu): '%s'!\n", required_found+1, args.required_count, arg);
-            return false;
-        }
-        clags_req_t current_req = args.required[required_found];
-        if (current_req.is_list){
-            in_list = true;
-            if (!clags__append_to_list(current_req, arg)) return false;
-            continue;
+#ifdef CLAGS_STATS
+uint64_t clags__now(void)
+{
+    struct timespec ts;
+#ifdef CLAGS__POSIX
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec*1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+// runs the verify function of a value type, attributing its time to the parse statistics
+bool clags__verify_into(clags__state_t *state, clags_value_type_t type, const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+{
+#ifdef CLAGS_STATS
+    if (state->stats){
+        uint64_t start = clags__now();
+        bool result = clags__verify_funcs[type](arg_name, arg, pvalue, func, state->error);
+        if (type == Clags_Custom) state->stats->custom_ns += clags__now() - start;
+        else state->stats->verify_ns += clags__now() - start;
+        return result;
+    }
+#else
+    (void) state;
+#endif
+    return clags__verify_funcs[type](arg_name, arg, pvalue, func, state->error);
+}
+
+// when only validating, built-in types convert into nothing and custom functions into scratch space
+bool clags__verify(clags__state_t *state, clags_value_type_t type, const char *arg_name, const char *arg, void *pvalue, clags_value_func_t func)
+{
+    if (!state->validate_only) return clags__verify_into(state, type, arg_name, arg, pvalue, func);
+    if (type != Clags_Custom) return clags__verify_into(state, type, arg_name, arg, NULL, func);
+    clags__align_t scratch[CLAGS_VALIDATE_SCRATCH_SIZE/sizeof(clags__align_t) + 1];
+    return clags__verify_into(state, type, arg_name, arg, scratch, func);
+}
+
+// the lazy record of an argument, which only single values have
+clags_lazy_t *clags__lazy(clags_arg_t *arg)
+{
+    if (arg->type == Clags_Required && !arg->req.is_list) return arg->req.lazy;
+    if (arg->type == Clags_Optional && !arg->opt.is_list) return arg->opt.lazy;
+    return NULL;
+}
+
+// forgets the tokens of a previous parse, so arguments that are not given keep their variable as it is
+void clags__lazy_reset(clags_arg_t *args, size_t arg_count)
+{
+    for (size_t i=0; i<arg_count; ++i){
+        clags_lazy_t *lazy = clags__lazy(&args[i]);
+        if (lazy == NULL) continue;
+        if (args[i].type == Clags_Required){
+            clags_req_t req = args[i].req;
+            *lazy = (clags_lazy_t){.name=req.name, .type=req.value_type, .func=req.value_func, .value=req.value};
         } else{
-            clags_req_t req = args.required[required_found++];
-            if (!clags__verify_funcs[req.value_type](req.name, arg, req.value, req.value_func)) return false;
-        }
-    next_arg:
-        if (in_list){
-            required_found++;
-            in_list = false;
+            clags_opt_t opt = args[i].opt;
+            *lazy = (clags_lazy_t){.name=opt.long_flag? opt.long_flag:opt.short_flag, .type=opt.value_type, .func=opt.value_func, .value=opt.value};
         }
     }
-    if (in_list) required_found++;
-    if (required_found != args.required_count){
-        fprintf(stderr, "[ERROR] Missing required arguments:");
-        for (size_t i=required_found; i<args.required_count; ++i){
-            fprintf(stderr, " <%s>", args.required[i].name);
-        }
-        fprintf(stderr, "!\n");
+}
+
+// records the token of a lazy argument; built-in values are cheap enough to be validated right away without
+// being stored, custom values are only checked when they are converted
+bool clags__defer(clags__state_t *state, clags_lazy_t *lazy, const char *arg_name, char *arg)
+{
+    if (lazy->type != Clags_Custom && !clags__verify(state, lazy->type, arg_name, arg, NULL, NULL)) return false;
+    lazy->token = arg;
+    lazy->name = arg_name;
+    lazy->pending = true;
+    return true;
+}
+
+// converts one item into a scratch buffer and hands it to the stream callback
+bool clags__stream_item(clags__state_t *state, clags_req_t req, const char *arg)
+{
+    clags_stream_t *stream = (clags_stream_t*) req.value;
+    clags__align_t item[(stream->item_size + sizeof(clags__align_t)-1)/sizeof(clags__align_t) + 1];
+    if (!clags__verify(state, req.value_type, req.name, arg, item, req.value_func)) return false;
+    if (state->validate_only) return true;
+    if (!stream->func(item, stream->ctx)){
+        clags__report(state->error, Clags_Error_Rejected, "Value for argument '%s' was rejected: '%s'!", req.name, arg);
         return false;
     }
+    stream->count++;
     return true;
 }
 
-void clags__usage(const char *program_name, clags_arg_t *_args, size_t arg_count)
+// streams whitespace separated items from stdin through a fixed size buffer
+bool clags__stream_chunks(clags__state_t *state, clags_req_t req, char *buffer)
 {
-    clags_req_t required[arg_count];
-    clags_opt_t optional[arg_count];
-    clags_flag_t flags[arg_count];
-
-    clags_args_t args = {.required=required, .optional=optional, .flags=flags};
-    
-    clags__sort_args(&args, _args, arg_count);
-
-    printf("Usage: %s", program_name);
-    if (args.optional_count) printf(" [OPTIONS]");
-    if (args.flag_count) printf(" [FLAGS]");
-    for (size_t i=0; i<args.required_count; ++i){
-        printf(" <%s%s>", args.required[i].name, args.required[i].is_list?"..":"");
-    }
-    printf("\n");
-    
-    if (args.required_count){
-        printf("  Arguments:\n");
-        for (size_t i=0; i<args.required_count; ++i){
-            clags_req_t req = args.required[i];
-            printf("    %*s : %s", CLAGS_USAGE_ALIGNMENT, req.name, req.description);
-            if (req.value_type != Clags_None) printf(" (%s%s)", clags__type_names[req.value_type], req.is_list?"[]":"");
-            printf("\n");
-        }
-    }
-    if (args.optional_count){
-        printf("  Options:\n");
-        for (size_t i=0; i<args.optional_count; ++i){
-            clags_opt_t opt = args.optional[i];
-            if (opt.short_flag){
-                if (opt.long_flag){
-                    size_t buf_size = strlen(opt.short_flag) + strlen(opt.long_flag) + (opt.field_name? strlen(opt.field_name):0) + 6;
-                    char buf[buf_size];
-                    snprintf(buf, buf_size, "%s, %s(=)%s>", opt.short_flag, opt.long_flag, opt.field_name);
-                    printf("    %*s : %s", CLAGS_USAGE_ALIGNMENT, buf, opt.description);
-                } else{
-                    printf("    %*s : %s", CLAGS_USAGE_ALIGNMENT, opt.short_flag, opt.description);
-                }
-                if (opt.value_type != Clags_None) printf(" (%s)", clags__type_names[opt.value_type]);
-                printf("\n");
-            }else if (opt.long_flag){
-                size_t buf_size = strlen(opt.long_flag) + (opt.field_name? strlen(opt.field_name):0) + 4;
-                char buf[buf_size];
-                snprintf(buf, buf_size, "%s(=)%s", opt.long_flag, opt.field_name);
-                printf("    %*s : %s", CLAGS_USAGE_ALIGNMENT, buf, opt.description);
-                if (opt.value_type != Clags_None) printf(" (%s)", clags__type_names[opt.value_type]);
-                printf("\n");
+    size_t length = 0;
+    bool eof = false;
+    while (!eof){
+        size_t read = fread(buffer+length, 1, CLAGS_STREAM_CHUNK_SIZE-length, stdin);
+        if (read == 0){
+            if (ferror(stdin)){
+                clags__report(state->error, Clags_Error_Input, "Failed to read values for argument '%s' from stdin!", req.name);
+                return false;
             }
+            eof = true;
         }
-    }
-    if (args.flag_count){
-        printf("  Flags:\n");
-        for (size_t i=0; i<args.flag_count; ++i){
-            clags_flag_t flag = args.flags[i];
-            if (flag.short_flag){
-                if (flag.long_flag){
-                    size_t buf_size = strlen(flag.short_flag) + strlen(flag.long_flag) + 12;
-                    char buf[buf_size];
-                    snprintf(buf, buf_size, "%s, %s", flag.short_flag, flag.long_flag);
-                    printf("    %*s : %s\n", CLAGS_USAGE_ALIGNMENT, buf, flag.description);
-                } else{
-                    printf("    %*s : %s\n", CLAGS_USAGE_ALIGNMENT, flag.short_flag, flag.description);
-                }
-            } else if (flag.long_flag){
-                printf("    %*s : %s\n", CLAGS_USAGE_ALIGNMENT, flag.long_flag, flag.description);
+        length += read;
+        char *cursor = buffer, *end = buffer+length;
+        while (cursor < end){
+            while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r' || *cursor == '\v' || *cursor == '\f')) cursor++;
+            char *token = cursor;
+            while (cursor < end && !(*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r' || *cursor == '\v' || *cursor == '\f')) cursor++;
+            if (cursor == end && !eof){
+                // the token may continue in the next chunk
+                cursor = token;
+                break;
             }
+            if (token == cursor) continue;
+            *cursor++ = '\0';
+            if (!clags__stream_item(state, req, token)) return false;
+        }
+        length = buffer+length > cursor? (size_t)(buffer+length-cursor):0;
+        if (length == CLAGS_STREAM_CHUNK_SIZE){
+            clags__report(state->error, Clags_Error_Input, "Value for argument '%s' from stdin exceeds %d bytes!", req.name, CLAGS_STREAM_CHUNK_SIZE);
+            return false;
         }
+        memmove(buffer, cursor, length);
     }
+    return true;
 }
 
-void clags_list_free(clags_list_t *list)
+// the chunk buffer is too large for the stack, so it comes from the allocator of the parse
+bool clags__stream_stdin(clags__state_t *state, clags_req_t req)
 {
-    free(list->items);
-    list->items = NULL;
-    list->count = list->capacity = 0;
+    if (state->validate_only) return true;
+    char *buffer = (char*) clags__alloc(state->allocator, CLAGS_STREAM_CHUNK_SIZE+1);
+    if (buffer == NULL){
+        clags__report(state->error, Clags_Error_Memory, "Failed to allocate memory for argument '%s' from stdin!", req.name);
+        return false;
+    }
+    CLAGS__STAT_ADD(state, bytes_allocated, CLAGS_STREAM_CHUNK_SIZE+1);
+    bool result = clags__stream_chunks(state, req, buffer);
+    clags__free(state->allocator, buffer, CLAGS_STREAM_CHUNK_SIZE+1);
+    return result;
+}
+
+typedef void (*clags__task_func_t)(void *ctx, size_t index);
+
+typedef struct{
+    clags__task_func_t func;
+    void *ctx;
+    size_t count;
+    size_t next;
+#ifdef CLAGS__THREADS
+    pthread_mutex_t lock;
+#endif
+} clags__pool_t;
+
+// claims tasks from the shared counter until all are taken, so fast workers pick up the slack of slow ones
+void *clags__pool_worker(void *arg)
+{
+    clags__pool_t *pool = (clags__pool_t*) arg;
+    for (;;){
+#ifdef CLAGS__THREADS
+        pthread_mutex_lock(&pool->lock);
+        size_t index = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+#else
+        size_t index = pool->next++;
+#endif
+        if (index >= pool->count) return NULL;
+        pool->func(pool->ctx, index);
+    }
+}
+
+// the number of threads to use for count tasks, where 0 asks for one per core
+size_t clags__thread_count(size_t threads, size_t count)
+{
+#ifdef CLAGS__THREADS
+    if (threads == 0){
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0? (size_t)cores:1;
+    }
+    if (threads > count) threads = count;
+    if (threads > CLAGS_MAX_THREADS) threads = CLAGS_MAX_THREADS;
+    return threads;
+#else
+    (void) threads;
+    (void) count;
+    return 1;
+#endif
+}
+
+// runs func for every index on up to threads threads (0 for one per core), the calling thread included
+void clags__parallel_for(size_t count, size_t threads, clags__task_func_t func, void *ctx)
+{
+    clags__pool_t pool = {.func=func, .ctx=ctx, .count=count};
+#ifdef CLAGS__THREADS
+    threads = clags__thread_count(threads, count);
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_t workers[CLAGS_MAX_THREADS];
+    size_t started = 0;
+    while (started+1 < threads && pthread_create(&workers[started], NULL, clags__pool_worker, &pool) == 0) started++;
+    clags__pool_worker(&pool);
+    for (size_t i=0; i<started; ++i) pthread_join(workers[i], NULL);
+    pthread_mutex_destroy(&pool.lock);
+#else
+    (void) threads;
+    clags__pool_worker(&pool);
+#endif
+}
+
+// makes room for at least extra more items
+bool clags__list_reserve(clags__state_t *state, clags_list_t *list, const char *name, size_t extra)
+{
+    if (list->count + extra <= list->capacity) return true;
+    if (list->fixed){
+        clags__report(state->error, Clags_Error_ListFull, "Too many values for list argument '%s' (maximum %zu)!", name, list->capacity);
+        return false;
+    }
+    // a list keeps the allocator it was first grown with
+    if (list->items == NULL) list->allocator = clags__keep_allocator(state->allocator);
+    size_t new_capacity = list->capacity==0? 8:list->capacity*2;
+    if (new_capacity < list->count + extra) new_capacity = list->count + extra;
+    void *items = clags__realloc(&list->allocator, list->items, list->capacity*list->item_size, new_capacity*list->item_size);
+    if (items == NULL){
+        clags__report(state->error, Clags_Error_Memory, "Failed to allocate memory for list argument '%s'!", name);
+        return false;
+    }
+    CLAGS__STAT_ADD(state, list_reallocs, 1);
+    CLAGS__STAT_ADD(state, bytes_allocated, (new_capacity - list->capacity)*list->item_size);
+    list->items = items;
+    list->capacity = new_capacity;
+    return true;
+}
+
+typedef struct{
+    char *start;   // the first item, for items stored one after another
+} clags__chunk_t;
+
+// a range of list items split into chunks that are converted independently
+typedef struct{
+    clags_value_type_t type;
+    clags_value_func_t func;
+    const char *name;
+    char *slots;
+    size_t item_size;
+    char **tokens;  // the items, or NULL if every chunk walks its items from start
+    size_t count;
+    size_t chunk_size;
+    clags__chunk_t *chunks;
+    size_t failed;  // the lowest index of an item that failed so far, or SIZE_MAX; shared by all chunks
+} clags__convert_t;
+
+size_t clags__failed_load(size_t *failed)
+{
+#ifdef CLAGS__THREADS
+    return __atomic_load_n(failed, __ATOMIC_RELAXED);
+#else
+    return *failed;
+#endif
+}
+
+void clags__failed_lower(size_t *failed, size_t index)
+{
+#ifdef CLAGS__THREADS
+    size_t current = __atomic_load_n(failed, __ATOMIC_RELAXED);
+    while (index < current && !__atomic_compare_exchange_n(failed, &current, index, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){}
+#else
+    if (index < *failed) *failed = index;
+#endif
+}
+
+void clags__convert_task(void *ctx, size_t index)
+{
+    clags__convert_t *convert = (clags__convert_t*) ctx;
+    clags__chunk_t *chunk = &convert->chunks[index];
+    size_t first = index*convert->chunk_size;
+    size_t last = first+convert->chunk_size < convert->count? first+convert->chunk_size:convert->count;
+    // failures are reported again in order by the caller, this only keeps them off stderr
+    clags_error_t error;
+    char *text = chunk->start;
+    for (size_t i=first; i<last; ++i){
+        // the sequential path never gets behind a failed item, so neither does any chunk once it is known
+        if (i > clags__failed_load(&convert->failed)) return;
+        char *item = convert->tokens? convert->tokens[i]:text;
+        if (text) text += strlen(text)+1;
+        if (!clags__verify_funcs[convert->type](convert->name, item, convert->slots+i*convert->item_size, convert->func, &error)){
+            clags__failed_lower(&convert->failed, i);
+            return;
+        }
+    }
+}
+
+// the number of chunks for count items on threads threads, a few per thread to even out their speed
+size_t clags__chunk_size(size_t count, size_t threads)
+{
+    size_t chunks = threads*4;
+    return (count + chunks-1)/chunks;
+}
+
+// converts the items of a clags__convert_t on several threads; returns the index of the first item
+// that failed, in the order of the items, or count if all were converted
+size_t clags__convert_items(clags__state_t *state, clags__convert_t *convert, size_t chunk_count)
+{
+#ifdef CLAGS_STATS
+    uint64_t start = clags__now();
+    clags__parallel_for(chunk_count, state->threads, clags__convert_task, convert);
+    if (convert->type == Clags_Custom) CLAGS__STAT_ADD(state, custom_ns, clags__now() - start);
+    else CLAGS__STAT_ADD(state, verify_ns, clags__now() - start);
+#else
+    (void) state;
+    clags__parallel_for(chunk_count, state->threads, clags__convert_task, convert);
+#endif
+    // every item in front of the lowest failed one was converted, as no chunk stops before reaching it
+    return convert->failed < convert->count? convert->failed:convert->count;
+}
+
+// reports the item that failed in a chunked conversion as the sequential path would; built-in values are converted
+// once more, custom functions are not called again, as they may not give the same answer twice
+bool clags__convert_failed(clags__state_t *state, clags__convert_t *convert, size_t index, const char *item)
+{
+    if (convert->type != Clags_Custom) return clags__verify(state, convert->type, convert->name, item, convert->slots + index*convert->item_size, NULL);
+    clags__report_rejected(state->error, convert->name, item);
+    return false;
+}
+
+// the number of list items from which converting them in chunks pays off
+size_t clags__parallel_threshold(clags_value_type_t type, bool thread_safe)
+{
+    if (type != Clags_Custom) return CLAGS_PARALLEL_THRESHOLD;
+    return thread_safe? CLAGS_PARALLEL_CUSTOM_THRESHOLD:SIZE_MAX;
+}
+
+// the number of tokens in front of argv that all go into the current required list, if that is a list
+// that may be converted on several threads, and 0 otherwise; threshold receives the run length that is worth it
+size_t clags__list_run(clags__state_t *state, int argc, char **argv, size_t *threshold)
+{
+    clags_spec_t *spec = state->spec;
+    if (state->pending || state->feed || state->validate_only || state->required_found >= spec->required_count) return 0;
+    clags_req_t req = spec->required[state->required_found]->req;
+    *threshold = clags__parallel_threshold(req.value_type, req.thread_safe);
+    if (!req.is_list || req.is_stream || *threshold == SIZE_MAX) return 0;
+    if (spec->bare_flags || (state->parent && state->parent->bare_flags)) return 0;
+#ifdef CLAGS_STATS
+    if (state->trace) return 0;
+#endif
+    size_t run = 0;
+    while (run < (size_t)argc && argv[run][0] != '-' && !(state->response_files && argv[run][0] == '@')) run++;
+    // a fixed list is only filled up, the token that does not fit any more is reported by the sequential path
+    clags_list_t *list = (clags_list_t*) req.value;
+    if (list->fixed && run > list->capacity - list->count) run = list->capacity - list->count;
+    return run;
+}
+
+// converts a run of tokens of the current required list on several threads straight into their slots;
+// returns how many were converted, which is less than count if one of them failed
+size_t clags__append_tokens(clags__state_t *state, char **tokens, size_t count)
+{
+    clags_req_t req = state->spec->required[state->required_found]->req;
+    clags_list_t *list = (clags_list_t*) req.value;
+    if (!clags__list_reserve(state, list, req.name, count)) return 0;
+    state->in_list = true;
+    size_t chunk_size = clags__chunk_size(count, clags__thread_count(state->threads, count));
+    size_t chunk_count = (count + chunk_size-1)/chunk_size;
+    clags__chunk_t chunks[chunk_count];
+    memset(chunks, 0, sizeof(chunks));
+    clags__convert_t convert = {.type=req.value_type, .func=req.value_func, .name=req.name, .slots=(char*) list->items + list->count*list->item_size,
+                                .item_size=list->item_size, .tokens=tokens, .count=count, .chunk_size=chunk_size, .chunks=chunks, .failed=SIZE_MAX};
+    size_t converted = clags__convert_items(state, &convert, chunk_count);
+    CLAGS__STAT_ADD(state, tokens, converted < count? converted+1:count);
+#ifdef CLAGS_STATS
+    state->token_index += converted < count? converted+1:count;
+#endif
+    if (converted == count){
+        list->count += count;
+        return count;
+    }
+    list->count += converted+1;
+    clags__convert_failed(state, &convert, converted, tokens[converted]);
+    return converted;
+}
+
+bool clags__append_to_list(clags__state_t *state, clags_req_t req, const char *arg)
+{
+    if (req.is_stream) return clags__stream_item(state, req, arg);
+    if (state->validate_only) return clags__verify(state, req.value_type, req.name, arg, NULL, req.value_func);
+    clags_list_t *list = (clags_list_t*) req.value;
+    if (!clags__list_reserve(state, list, req.name, 1)) return false;
+    char *ptr = (char*) list->items;
+    return clags__verify(state, req.value_type, req.name, arg, ptr+list->item_size*list->count++, req.value_func);
+}
+
+struct clags__mapping_t{
+    clags__mapping_t *next;
+    clags_allocator_t allocator;
+    char *data;
+    size_t size;
+    bool mapped;
+};
+
+// copies a value that list items will point into; the copy follows its header and is owned by the list
+char *clags__keep_copy(clags__state_t *state, clags_list_t *list, const char *name, const char *value, size_t length)
+{
+    clags__mapping_t *copy = (clags__mapping_t*) clags__alloc(state->allocator, sizeof(*copy) + length+1);
+    if (copy == NULL){
+        clags__report(state->error, Clags_Error_Memory, "Failed to allocate memory for list argument '%s'!", name);
+        return NULL;
+    }
+    *copy = (clags__mapping_t){.next=list->copies, .allocator=clags__keep_allocator(state->allocator), .data=(char*) (copy+1), .size=length+1};
+    memcpy(copy->data, value, length+1);
+    list->copies = copy;
+    return copy->data;
+}
+
+void clags__free_copies(clags_list_t *list)
+{
+    while (list->copies){
+        clags__mapping_t *copy = list->copies;
+        list->copies = copy->next;
+        clags__free(&copy->allocator, copy, sizeof(*copy) + copy->size);
+    }
+}
+
+// splits a delimited option value and converts every item straight into its list slot; string and custom items
+// may be kept by pointer, so they are split off a copy, while built-in values are split in place and the
+// separators are put back afterwards, leaving the argument as it was
+bool clags__append_delimited(clags__state_t *state, clags_opt_t opt, const char *arg_name, char *value)
+{
+    clags_list_t *list = (clags_list_t*) opt.value;
+    char separator = opt.separator? opt.separator:CLAGS_LIST_SEPARATOR;
+    size_t length = strlen(value);
+    char *end = value+length;
+
+    size_t count = 1;
+    for (char *p=value; (p = (char*) memchr(p, separator, end-p)) != NULL; ++p){
+        if (p == value || p+1 == end || p[1] == separator){
+            clags__report(state->error, Clags_Error_InvalidValue, "Empty item in list value for argument '%s': '%s'!", arg_name, value);
+            return false;
+        }
+        count++;
+    }
+    if (state->validate_only){
+        // the token may be shared with other threads, so items are copied out instead of split in place,
+        // into a scratch buffer or, for longer items, into memory from the allocator
+        char scratch[256];
+        for (char *item=value; item < end;){
+            char *next = (char*) memchr(item, separator, end-item);
+            if (next == NULL) next = end;
+            size_t size = (size_t)(next-item) + 1;
+            char *copy = size <= sizeof(scratch)? scratch:(char*) clags__alloc(state->allocator, size);
+            if (copy == NULL){
+                clags__report(state->error, Clags_Error_Memory, "Failed to allocate memory for an item of argument '%s'!", arg_name);
+                return false;
+            }
+            memcpy(copy, item, size-1);
+            copy[size-1] = '\0';
+            bool valid = clags__verify(state, opt.value_type, arg_name, copy, NULL, opt.value_func);
+            if (copy != scratch) clags__free(state->allocator, copy, size);
+            if (!valid) return false;
+            item = next+1;
+        }
+        return true;
+    }
+    if (!clags__list_reserve(state, list, arg_name, count)) return false;
+    bool copied = opt.value_type == Clags_None || opt.value_type == Clags_Custom;
+    if (copied){
+        value = clags__keep_copy(state, list, arg_name, value, length);
+        if (value == NULL) return false;
+        end = value+length;
+    }
+
+    bool result = true;
+    size_t threads = count >= clags__parallel_threshold(opt.value_type, opt.thread_safe)? clags__thread_count(state->threads, count):1;
+    if (threads > 1){
+        size_t chunk_size = clags__chunk_size(count, threads);
+        size_t chunk_count = (count + chunk_size-1)/chunk_size;
+        clags__chunk_t chunks[chunk_count];
+        size_t i = 0;
+        for (char *item=value; item < end; ++i){
+            char *next = (char*) memchr(item, separator, end-item);
+            if (next == NULL) next = end;
+            *next = '\0';
+            if (i % chunk_size == 0) chunks[i/chunk_size].start = item;
+            item = next+1;
+        }
+        clags__convert_t convert = {.type=opt.value_type, .func=opt.value_func, .name=arg_name, .slots=(char*) list->items + list->count*list->item_size,
+                                    .item_size=list->item_size, .count=count, .chunk_size=chunk_size, .chunks=chunks, .failed=SIZE_MAX};
+        size_t converted = clags__convert_items(state, &convert, chunk_count);
+        if (converted == count){
+            list->count += count;
+        } else{
+            char *item = chunks[converted/chunk_size].start;
+            for (size_t j=converted/chunk_size*chunk_size; j<converted; ++j) item += strlen(item)+1;
+            list->count += converted+1;
+            result = clags__convert_failed(state, &convert, converted, item);
+        }
+    } else{
+        char *ptr = (char*) list->items;
+        for (char *item=value; item < end && result;){
+            char *next = (char*) memchr(item, separator, end-item);
+            if (next == NULL) next = end;
+            *next = '\0';
+            result = clags__verify(state, opt.value_type, arg_name, item, ptr+list->item_size*list->count++, opt.value_func);
+            item = next+1;
+        }
+    }
+    if (!copied){
+        for (char *p=value; p < end; ++p){
+            if (*p == '\0') *p = separator;
+        }
+    }
+    return result;
+}
+
+bool clags__set_option(clags__state_t *state, clags_opt_t opt, const char *arg_name, char *value)
+{
+    if (opt.is_list) return clags__append_delimited(state, opt, arg_name, value);
+    if (opt.lazy && !state->validate_only) return clags__defer(state, opt.lazy, arg_name, value);
+    return clags__verify(state, opt.value_type, arg_name, value, opt.value, opt.value_func);
+}
+
+uint32_t clags__hash(const char *str, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i=0; i<length; ++i){
+        hash ^= (unsigned char) str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+size_t clags__index_capacity(clags_arg_t *args, size_t arg_count)
+{
+    size_t keys = 0;
+    for (size_t i=0; i<arg_count; ++i){
+        if (args[i].type == Clags_Optional){
+            keys += (args[i].opt.short_flag != NULL) + (args[i].opt.long_flag != NULL);
+        } else if (args[i].type == Clags_Flag){
+            keys += (args[i].flag.short_flag != NULL) + (args[i].flag.long_flag != NULL);
+        } else if (args[i].type == Clags_Command){
+            keys++;
+        }
+    }
+    size_t capacity = 4;
+    while (capacity < keys*2) capacity *= 2;
+    return capacity;
+}
+
+size_t clags__env_capacity(clags_arg_t *args, size_t arg_count)
+{
+    size_t keys = 0;
+    for (size_t i=0; i<arg_count; ++i){
+        keys += args[i].type == Clags_Optional && args[i].opt.env != NULL;
+    }
+    if (keys == 0) return 0;
+    size_t capacity = 4;
+    while (capacity < keys*2) capacity *= 2;
+    return capacity;
+}
+
+// the number of bytes clags__spec_init needs for the sorted views and the env index, and the flag index if indexed
+size_t clags__spec_bytes(clags_arg_t *args, size_t arg_count, bool indexed)
+{
+    size_t capacity = indexed? clags__index_capacity(args, arg_count):0;
+    return arg_count*sizeof(clags_arg_t*) + (capacity + clags__env_capacity(args, arg_count))*sizeof(clags__index_entry_t);
+}
+
+size_t clags__spec_size(clags_arg_t *args, size_t arg_count)
+{
+    return clags__spec_bytes(args, arg_count, true);
+}
+
+void clags__table_insert(clags__index_entry_t *index, size_t mask, const char *flag, clags_arg_t *arg)
+{
+    if (flag == NULL) return;
+    size_t length = strlen(flag);
+    uint32_t hash = clags__hash(flag, length);
+    for (size_t i=hash&mask;; i=(i+1)&mask){
+        clags__index_entry_t *entry = &index[i];
+        if (entry->flag == NULL){
+            *entry = (clags__index_entry_t){.flag=flag, .hash=hash, .length=(uint32_t)length, .arg=arg};
+            return;
+        }
+        // the first argument using a flag shadows all later ones
+        if (entry->hash == hash && entry->length == length && memcmp(entry->flag, flag, length) == 0) return;
+    }
+}
+
+void clags__index_insert(clags_spec_t *spec, const char *flag, clags_arg_t *arg)
+{
+    if (spec->lookup) return;
+    clags__table_insert(spec->index, spec->index_mask, flag, arg);
+}
+
+// comparisons may be NULL, otherwise it is incremented for every full string comparison
+clags_arg_t *clags__table_lookup(const clags__index_entry_t *index, size_t mask, const char *flag, size_t length, size_t *comparisons)
+{
+    uint32_t hash = clags__hash(flag, length);
+    for (size_t i=hash&mask;; i=(i+1)&mask){
+        const clags__index_entry_t *entry = &index[i];
+        if (entry->flag == NULL) return NULL;
+        if (entry->hash == hash && entry->length == length){
+#ifdef CLAGS_STATS
+            if (comparisons) (*comparisons)++;
+#else
+            (void) comparisons;
+#endif
+            if (memcmp(entry->flag, flag, length) == 0) return entry->arg;
+        }
+    }
+}
+
+clags_arg_t *clags__index_lookup(clags_spec_t *spec, const char *flag, size_t length, size_t *comparisons)
+{
+    if (spec->lookup) return spec->lookup(spec, flag, length);
+    return clags__table_lookup(spec->index, spec->index_mask, flag, length, comparisons);
+}
+
+// without a lookup function all flags are indexed, otherwise the flag index is left out
+void clags__spec_init_lookup(clags_spec_t *spec, clags_arg_t *args, size_t arg_count, void *memory, clags_lookup_func_t lookup)
+{
+    size_t capacity = lookup? 0:clags__index_capacity(args, arg_count);
+    clags_arg_t **sorted = (clags_arg_t**) memory;
+    clags__index_entry_t *tables = (clags__index_entry_t*) (sorted+arg_count);
+    *spec = (clags_spec_t){.args=args, .arg_count=arg_count, .lookup=lookup};
+    if (capacity){
+        spec->index = tables;
+        spec->index_mask = capacity-1;
+        memset(spec->index, 0, capacity*sizeof(*spec->index));
+    }
+    size_t env_capacity = clags__env_capacity(args, arg_count);
+    if (env_capacity){
+        spec->env_index = tables + capacity;
+        spec->env_mask = env_capacity-1;
+        memset(spec->env_index, 0, env_capacity*sizeof(*spec->env_index));
+    }
+
+    for (size_t i=0; i<arg_count; ++i){
+        switch(args[i].type){
+            case Clags_Required: spec->required_count++; break;
+            case Clags_Optional: spec->optional_count++; break;
+            case Clags_Flag:     spec->flag_count++;     break;
+            case Clags_Command:  spec->command_count++;  break;
+            default: {
+                assert(0 && "Unreachable");
+            }
+        }
+    }
+    spec->required = sorted;
+    spec->optional = spec->required + spec->required_count;
+    spec->flags = spec->optional + spec->optional_count;
+    spec->commands = spec->flags + spec->flag_count;
+    size_t required_count = 0, optional_count = 0, flag_count = 0, command_count = 0;
+    for (size_t i=0; i<arg_count; ++i){
+        switch(args[i].type){
+            case Clags_Required: spec->required[required_count++] = &args[i]; break;
+            case Clags_Optional: spec->optional[optional_count++] = &args[i]; break;
+            case Clags_Flag:     spec->flags[flag_count++] = &args[i];        break;
+            case Clags_Command:  spec->commands[command_count++] = &args[i];  break;
+        }
+    }
+
+    // options take precedence over flags sharing the same name
+    for (size_t i=0; i<spec->optional_count; ++i){
+        clags_opt_t opt = spec->optional[i]->opt;
+        clags__index_insert(spec, opt.short_flag, spec->optional[i]);
+        clags__index_insert(spec, opt.long_flag, spec->optional[i]);
+        if ((opt.short_flag && opt.short_flag[0] != '-') || (opt.long_flag && opt.long_flag[0] != '-')) spec->bare_flags = true;
+        if (opt.env) clags__table_insert(spec->env_index, spec->env_mask, opt.env, spec->optional[i]);
+        if (opt.env || opt.config_key) spec->fallbacks = true;
+        if (opt.lazy && !opt.is_list) spec->lazy = true;
+    }
+    for (size_t i=0; i<spec->required_count; ++i){
+        if (spec->required[i]->req.lazy && !spec->required[i]->req.is_list) spec->lazy = true;
+    }
+    for (size_t i=0; i<spec->flag_count; ++i){
+        clags_arg_t *arg = spec->flags[i];
+        clags__index_insert(spec, arg->flag.short_flag, arg);
+        clags__index_insert(spec, arg->flag.long_flag, arg);
+        if ((arg->flag.short_flag && arg->flag.short_flag[0] != '-') || (arg->flag.long_flag && arg->flag.long_flag[0] != '-')) spec->bare_flags = true;
+
+        // both "-v" and "v" can be combined as in "-xvf"
+        const char *sf = arg->flag.short_flag;
+        if (sf == NULL || sf[0] == '\0') continue;
+        unsigned char c;
+        if (sf[0] == '-' && sf[1] != '\0' && sf[2] == '\0') c = (unsigned char) sf[1];
+        else if (sf[0] != '-' && sf[1] == '\0') c = (unsigned char) sf[0];
+        else continue;
+        if (spec->short_flags[c] == NULL) spec->short_flags[c] = arg;
+    }
+    // only the names are indexed, a command's own table is compiled when it is selected
+    for (size_t i=0; i<spec->command_count; ++i){
+        clags__index_insert(spec, spec->commands[i]->cmd.name, spec->commands[i]);
+    }
+}
+
+void clags__spec_init(clags_spec_t *spec, clags_arg_t *args, size_t arg_count, void *memory)
+{
+    clags__spec_init_lookup(spec, args, arg_count, memory, NULL);
+}
+
+bool clags__compile_lookup(clags_spec_t *spec, clags_arg_t *args, size_t arg_count, clags_lookup_func_t lookup, const clags_allocator_t *allocator)
+{
+    void *memory = clags__alloc(allocator, clags__spec_bytes(args, arg_count, lookup == NULL));
+    if (memory == NULL){
+        fprintf(stderr, "[ERROR] Failed to allocate memory for the argument specification!\n");
+        return false;
+    }
+#ifdef CLAGS_STATS
+    uint64_t start = clags__now();
+    clags__spec_init_lookup(spec, args, arg_count, memory, lookup);
+    spec->compile_ns = clags__now() - start;
+#else
+    clags__spec_init_lookup(spec, args, arg_count, memory, lookup);
+#endif
+    spec->memory = memory;
+    spec->allocator = clags__keep_allocator(allocator);
+    return true;
+}
+
+bool clags__compile(clags_spec_t *spec, clags_arg_t *args, size_t arg_count, const clags_allocator_t *allocator)
+{
+    return clags__compile_lookup(spec, args, arg_count, NULL, allocator);
+}
+
+void clags_spec_free(clags_spec_t *spec)
+{
+    if (spec->usage) clags__free(&spec->allocator, spec->usage, spec->usage_size);
+    if (spec->memory) clags__free(&spec->allocator, spec->memory, clags__spec_bytes(spec->args, spec->arg_count, spec->lookup == NULL));
+    *spec = (clags_spec_t){0};
+}
+
+void clags__end_list(clags__state_t *state)
+{
+    if (state->in_list){
+        state->required_found++;
+        state->in_list = false;
+    }
+}
+
+bool clags__set_flag(clags__state_t *state, clags_flag_t flag)
+{
+    if (flag.value != NULL && !state->validate_only) *flag.value = true;
+    if (flag.exit) state->exit = true;
+    return true;
+}
+
+// looks up a flag of the selected command, then among the global options and flags
+clags_arg_t *clags__lookup(clags__state_t *state, const char *arg, size_t length, size_t *comparisons)
+{
+    clags_arg_t *match = clags__index_lookup(state->spec, arg, length, comparisons);
+    if (match || state->parent == NULL) return match;
+    match = clags__index_lookup(state->parent, arg, length, comparisons);
+    return match && match->type != Clags_Command? match:NULL;
+}
+
+// records that an option was given, in the seen flags of the table it belongs to
+void clags__mark_seen(clags__state_t *state, clags_arg_t *arg)
+{
+    clags_spec_t *spec = state->spec;
+    if (arg >= spec->args && arg < spec->args+spec->arg_count){
+        if (state->seen) state->seen[arg - spec->args] = true;
+    } else if (state->parent_seen){
+        state->parent_seen[arg - state->parent->args] = true;
+    }
+}
+
+// compiles the table of the selected command and continues parsing with it, keeping the current table for global options
+bool clags__select_command(clags__state_t *state, clags_arg_t *arg)
+{
+    clags_cmd_t cmd = arg->cmd;
+    size_t spec_size = clags__spec_size(cmd.args, cmd.arg_count);
+    size_t size = sizeof(clags_spec_t) + spec_size + cmd.arg_count*sizeof(bool);
+    if (size > CLAGS_COMMAND_BUFFER_SIZE){
+        state->command_memory = clags__alloc(state->allocator, size);
+        if (state->command_memory == NULL){
+            clags__report(state->error, Clags_Error_Memory, "Failed to allocate memory for command '%s'!", cmd.name);
+            return false;
+        }
+        state->command_size = size;
+    }
+    clags_spec_t *spec = (clags_spec_t*) state->command_memory;
+#ifdef CLAGS_STATS
+    uint64_t start = clags__now();
+    clags__spec_init(spec, cmd.args, cmd.arg_count, spec+1);
+    CLAGS__STAT_ADD(state, sort_ns, clags__now() - start);
+#else
+    clags__spec_init(spec, cmd.args, cmd.arg_count, spec+1);
+#endif
+    if (spec->command_count){
+        clags__report(state->error, Clags_Error_UnknownCommand, "Command '%s' may not have commands of its own!", cmd.name);
+        return false;
+    }
+    state->command = arg;
+    state->parent = state->spec;
+    state->parent_seen = state->seen;
+    state->spec = spec;
+    state->seen = NULL;
+    if (spec->fallbacks){
+        state->seen = (bool*) ((char*) (spec+1) + spec_size);
+        memset(state->seen, 0, cmd.arg_count*sizeof(bool));
+    }
+    state->required_found = 0;
+    state->in_list = false;
+    if (spec->lazy && !state->validate_only) clags__lazy_reset(cmd.args, cmd.arg_count);
+    if (cmd.value && !state->validate_only) *cmd.value = true;
+    return true;
+}
+
+// processes a single command line token
+bool clags__feed(clags__state_t *state, char *arg)
+{
+    clags_spec_t *spec = state->spec;
+    if (state->pending){
+        clags_opt_t opt = state->pending->opt;
+        clags__mark_seen(state, state->pending);
+        state->pending = NULL;
+        return clags__set_option(state, opt, state->pending_flag, arg);
+    }
+    CLAGS__STAT_ADD(state, comparisons, 1);
+    if (strcmp(arg, "--") == 0){
+        clags__end_list(state);
+        return true;
+    }
+
+    size_t length = strlen(arg);
+    size_t *comparisons = state->stats? &state->stats->comparisons:NULL;
+    clags_arg_t *match = clags__lookup(state, arg, length, comparisons);
+    // command names are only recognized once all arguments in front of the command are given
+    if (match && match->type == Clags_Command && state->required_found < spec->required_count) match = NULL;
+    if (match){
+        clags__end_list(state);
+        if (match->type == Clags_Optional){
+            state->pending = match;
+            state->pending_flag = arg;
+            return true;
+        }
+        if (match->type == Clags_Command) return clags__select_command(state, match);
+        return clags__set_flag(state, match->flag);
+    }
+
+    char *value = (char*) memchr(arg, '=', length);
+    if (value){
+        match = clags__lookup(state, arg, value-arg, comparisons);
+        if (match && match->type == Clags_Optional && match->opt.long_flag && strlen(match->opt.long_flag) == (size_t)(value-arg)){
+            clags_opt_t opt = match->opt;
+            clags__mark_seen(state, match);
+            clags__end_list(state);
+            if (*++value == '\0'){
+                clags__report(state->error, Clags_Error_MissingValue, "Designated option assignment may not have an empty value: '%s'!", arg);
+                return false;
+            }
+            return clags__set_option(state, opt, opt.long_flag, value);
+        }
+    }
+
+    if (arg[0] == '-' && arg[1] == '\0' && state->required_found < spec->required_count && spec->required[state->required_found]->req.is_stream){
+        state->in_list = true;
+        return clags__stream_stdin(state, spec->required[state->required_found]->req);
+    }
+
+    if (arg[0] == '-' && arg[1] != '-' && length > 2){
+        for (size_t c=1; c<length; ++c){
+            clags_arg_t *flag = spec->short_flags[(unsigned char) arg[c]];
+            if (flag == NULL && state->parent) flag = state->parent->short_flags[(unsigned char) arg[c]];
+            if (flag == NULL){
+                clags__report(state->error, Clags_Error_UnknownFlag, "Unknown short flag in combination: '-%c'", arg[c]);
+                return false;
+            }
+            clags__set_flag(state, flag->flag);
+            if (state->exit) return true;
+        }
+        clags__end_list(state);
+        return true;
+    }
+
+    if (*arg == '-'){
+        clags__report(state->error, Clags_Error_UnknownOption, "Unknown option: '%s'!", arg);
+        return false;
+    }
+
+    if (state->required_found >= spec->required_count && spec->command_count){
+        clags__report(state->error, Clags_Error_UnknownCommand, "Unknown command: '%s'!", arg);
+        return false;
+    }
+    if (state->required_found >= spec->required_count){
+        clags__report(state->error, Clags_Error_TooManyArguments, "Unknown additional argument (%zu/%zu): '%s'!", state->required_found+1, spec->required_count, arg);
+        return false;
+    }
+    clags_req_t req = spec->required[state->required_found]->req;
+    if (req.is_list){
+        state->in_list = true;
+        return clags__append_to_list(state, req, arg);
+    }
+    state->required_found++;
+    if (req.lazy && !state->validate_only) return clags__defer(state, req.lazy, req.name, arg);
+    return clags__verify(state, req.value_type, req.name, arg, req.value, req.value_func);
+}
+
+// reports the required arguments from index found onwards as missing
+void clags__report_missing(clags_error_t *error, clags_arg_t *const *required, size_t found, size_t count)
+{
+    if (error){
+        size_t length = (size_t) snprintf(error->message, sizeof(error->message), "Missing required arguments:");
+        for (size_t i=found; i<count && length < sizeof(error->message); ++i){
+            length += (size_t) snprintf(error->message+length, sizeof(error->message)-length, " <%s>", required[i]->req.name);
+        }
+        if (length < sizeof(error->message)) snprintf(error->message+length, sizeof(error->message)-length, "!");
+        error->code = Clags_Error_MissingArguments;
+        return;
+    }
+    fprintf(stderr, "[ERROR] Missing required arguments:");
+    for (size_t i=found; i<count; ++i){
+        fprintf(stderr, " <%s>", required[i]->req.name);
+    }
+    fprintf(stderr, "!\n");
+}
+
+// checks that the token stream ended in a complete state
+bool clags__finish(clags__state_t *state)
+{
+    clags_spec_t *spec = state->spec;
+    if (state->exit) return true;
+    if (state->pending){
+        clags__report(state->error, Clags_Error_MissingValue, "Optional flag %s requires argument!", state->pending_flag);
+        return false;
+    }
+    clags__end_list(state);
+    if (state->required_found != spec->required_count){
+        clags__report_missing(state->error, spec->required, state->required_found, spec->required_count);
+        return false;
+    }
+    return true;
+}
+
+bool clags_parse_spec(int argc, char **argv, clags_spec_t *spec)
+{
+    return clags_parse_with(argc, argv, spec, NULL);
+}
+
+// loads a file with one writable zero byte behind its content, mapping it copy-on-write where possible
+bool clags__load_file(const clags_allocator_t *allocator, const char *path, char **data, size_t *size, bool *mapped)
+{
+    // without anonymous mappings the file is read into memory like anywhere else
+#if defined(CLAGS__POSIX) && defined(MAP_ANONYMOUS)
+    (void) allocator;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)){
+        close(fd);
+        return false;
+    }
+    *size = (size_t) st.st_size;
+    // reserve an anonymous zero page behind the file, so the last token can be terminated in place
+    char *base = (char*) mmap(NULL, *size+1, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED){
+        close(fd);
+        return false;
+    }
+    if (*size && mmap(base, *size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, fd, 0) == MAP_FAILED){
+        munmap(base, *size+1);
+        close(fd);
+        return false;
+    }
+    close(fd);
+    *data = base;
+    *mapped = true;
+    return true;
+#else
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    long length = ok? ftell(file):-1;
+    if (length < 0 || fseek(file, 0, SEEK_SET) != 0 || (*data = (char*) clags__alloc(allocator, (size_t)length+1)) == NULL){
+        fclose(file);
+        return false;
+    }
+    *size = fread(*data, 1, (size_t)length, file);
+    (*data)[*size] = '\0';
+    fclose(file);
+    *mapped = false;
+    return true;
+#endif
+}
+
+void clags__unload_file(const clags_allocator_t *allocator, char *data, size_t size, bool mapped)
+{
+#ifdef CLAGS__POSIX
+    if (mapped){
+        munmap(data, size+1);
+        return;
+    }
+#endif
+    (void) mapped;
+    clags__free(allocator, data, size+1);
+}
+
+// splits the next token off a response file in place, honouring quotes and backslash escapes
+int clags__next_token(char **cursor, char *end, char **token, bool nul_delimited)
+{
+    char *r = *cursor;
+    if (nul_delimited){
+        while (r < end && *r == '\0') r++;
+        if (r == end) return 0;
+        *token = r;
+        r += strlen(r);
+        *cursor = r < end? r+1:end;
+        return 1;
+    }
+    while (r < end && (*r == ' ' || *r == '\t' || *r == '\n' || *r == '\r' || *r == '\v' || *r == '\f')) r++;
+    if (r == end) return 0;
+    char *w = r;
+    *token = r;
+    char quote = '\0';
+    for (; r < end; ++r){
+        char c = *r;
+        if (quote){
+            if (c == quote){
+                quote = '\0';
+            } else if (c == '\\' && quote == '"' && r+1 < end && (r[1] == '"' || r[1] == '\\')){
+                *w++ = *++r;
+            } else{
+                *w++ = c;
+            }
+        } else if (c == '\'' || c == '"'){
+            quote = c;
+        } else if (c == '\\' && r+1 < end){
+            *w++ = *++r;
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'){
+            break;
+        } else{
+            *w++ = c;
+        }
+    }
+    if (quote) return -1;
+    *w = '\0';
+    *cursor = r < end? r+1:end;
+    return 1;
+}
+
+bool clags__feed_arg(clags__state_t *state, char *arg, size_t depth);
+
+bool clags__expand_response_file(clags__state_t *state, const char *path, size_t depth)
+{
+    if (depth > CLAGS_RESPONSE_FILE_DEPTH){
+        clags__report(state->error, Clags_Error_ResponseFile, "Response files nested deeper than %d levels: '@%s'!", CLAGS_RESPONSE_FILE_DEPTH, path);
+        return false;
+    }
+    // without a limit, a few files naming each other many times would be read exponentially often
+    if (state->response_count >= CLAGS_RESPONSE_FILE_MAX){
+        clags__report(state->error, Clags_Error_ResponseFile, "More than %d response files in total: '@%s'!", CLAGS_RESPONSE_FILE_MAX, path);
+        return false;
+    }
+    state->response_count++;
+    char *data;
+    size_t size;
+    bool mapped;
+    if (!clags__load_file(state->allocator, path, &data, &size, &mapped)){
+        clags__report(state->error, Clags_Error_ResponseFile, "Could not read response file '%s'!", path);
+        return false;
+    }
+    if (size > CLAGS_RESPONSE_FILE_BUDGET - state->response_bytes){
+        clags__unload_file(state->allocator, data, size, mapped);
+        clags__report(state->error, Clags_Error_ResponseFile, "Response files exceed %zu bytes in total: '@%s'!", (size_t) CLAGS_RESPONSE_FILE_BUDGET, path);
+        return false;
+    }
+    state->response_bytes += size;
+    if (state->files){
+        clags__mapping_t *mapping = (clags__mapping_t*) clags__alloc(state->allocator, sizeof(*mapping));
+        if (mapping == NULL){
+            clags__unload_file(state->allocator, data, size, mapped);
+            clags__report(state->error, Clags_Error_Memory, "Failed to allocate memory for response file '%s'!", path);
+            return false;
+        }
+        *mapping = (clags__mapping_t){.next=state->files->head, .allocator=clags__keep_allocator(state->allocator), .data=data, .size=size, .mapped=mapped};
+        CLAGS__STAT_ADD(state, bytes_allocated, sizeof(*mapping));
+        state->files->head = mapping;
+    }
+
+    // files containing NUL bytes (e.g. from find -print0) are split on them verbatim
+    char *cursor = data, *end = data+size, *token;
+    bool nul_delimited = memchr(data, '\0', size) != NULL;
+    bool ok = true;
+    int result;
+    while (ok && !state->exit && (result = clags__next_token(&cursor, end, &token, nul_delimited)) != 0){
+        if (result < 0){
+            clags__report(state->error, Clags_Error_ResponseFile, "Unterminated quote in response file '%s'!", path);
+            ok = false;
+        } else{
+            ok = clags__feed_arg(state, token, depth);
+        }
+    }
+    // nothing can point into the file when only validating
+    if (state->validate_only && !state->files) clags__unload_file(state->allocator, data, size, mapped);
+    return ok;
+}
+
+bool clags__feed_arg(clags__state_t *state, char *arg, size_t depth)
+{
+#ifdef CLAGS_STATS
+    if (state->trace) state->trace(state->trace_ctx, state->token_index, arg);
+    state->token_index++;
+    CLAGS__STAT_ADD(state, tokens, 1);
+#endif
+    // the value of an option is taken as it is, so '-o @file' names the file instead of reading it
+    if (state->response_files && !state->pending && arg[0] == '@' && arg[1] != '\0') return clags__expand_response_file(state, arg+1, depth+1);
+    if (state->feed) return state->feed(state, arg);
+    return clags__feed(state, arg);
+}
+
+#ifdef CLAGS__POSIX
+extern char **environ;
+#endif
+
+char *clags__config_find(const clags_config_t *config, const char *key, size_t length)
+{
+    if (config->index == NULL) return NULL;
+    uint32_t hash = clags__hash(key, length);
+    for (size_t i=hash&config->index_mask;; i=(i+1)&config->index_mask){
+        const clags__config_entry_t *entry = &config->index[i];
+        if (entry->key == NULL) return NULL;
+        if (entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0) return entry->value;
+    }
+}
+
+// gives options missing from the command line their value from the environment, or else from the config file
+bool clags__fallback(clags__state_t *state, clags_arg_t *args, size_t arg_count, const clags__index_entry_t *env_index, size_t env_mask)
+{
+    if (state->env && env_index){
+#ifdef CLAGS__POSIX
+        // one pass over the environment instead of a getenv scan per option
+        for (char **var=environ; *var; ++var){
+            char *value = strchr(*var, '=');
+            if (value == NULL || value[1] == '\0') continue;
+            clags_arg_t *arg = clags__table_lookup(env_index, env_mask, *var, (size_t)(value-*var), NULL);
+            if (arg == NULL || state->seen[arg-args]) continue;
+            state->seen[arg-args] = true;
+            if (!clags__set_option(state, arg->opt, arg->opt.env, value+1)) return false;
+        }
+#else
+        for (size_t i=0; i<arg_count; ++i){
+            if (args[i].type != Clags_Optional || args[i].opt.env == NULL || state->seen[i]) continue;
+            char *value = getenv(args[i].opt.env);
+            if (value == NULL || *value == '\0') continue;
+            state->seen[i] = true;
+            if (!clags__set_option(state, args[i].opt, args[i].opt.env, value)) return false;
+        }
+#endif
+    }
+    if (state->config){
+        for (size_t i=0; i<arg_count; ++i){
+            if (args[i].type != Clags_Optional || args[i].opt.config_key == NULL || state->seen[i]) continue;
+            char *value = clags__config_find(state->config, args[i].opt.config_key, strlen(args[i].opt.config_key));
+            if (value && !clags__set_option(state, args[i].opt, args[i].opt.config_key, value)) return false;
+        }
+    }
+    return true;
+}
+
+// feeds argv, leaving position at the index of the failed token, or at argc if no token failed
+bool clags__feed_argv(clags__state_t *state, int argc, char **argv, size_t *position)
+{
+    bool result = true;
+    int index = 1;
+    int scanned = 0;  // no long enough list run starts in front of this index
+    for (; index<argc && !state->exit && result; ++index){
+        if (index >= scanned){
+            size_t threshold;
+            size_t run = clags__list_run(state, argc-index, argv+index, &threshold);
+            // the run is converted in chunks even on one thread, as it needs no matching per token
+            if (run && run >= threshold){
+                size_t converted = clags__append_tokens(state, argv+index, run);
+                result = converted == run;
+                index += (int)(result? run-1:converted);
+                continue;
+            }
+            scanned = index + (int)run + 1;
+        }
+        result = clags__feed_arg(state, argv[index], 0);
+    }
+    *position = result? (size_t)argc:(size_t)index-1;
+    return result;
+}
+
+// splits the command line into tokens one at a time and feeds them right away, leaving position
+// at the number of the failed token or at the number of tokens; the line never names response files
+bool clags__feed_line(clags__state_t *state, size_t *position)
+{
+    char *cursor = state->line, *end = cursor + strlen(cursor), *token;
+    int result;
+    *position = 0;
+    while (!state->exit && (result = clags__next_token(&cursor, end, &token, false)) != 0){
+        if (result < 0){
+            clags__report(state->error, Clags_Error_Input, "Unterminated quote in command line!");
+            return false;
+        }
+        if (!clags__feed_arg(state, token, 0)) return false;
+        ++*position;
+    }
+    return true;
+}
+
+bool clags__run_tokens(clags__state_t *state, int argc, char **argv)
+{
+    if (state->error) *state->error = (clags_error_t){Clags_Error_None};
+    size_t position;
+    bool result = state->line? clags__feed_line(state, &position):clags__feed_argv(state, argc, argv, &position);
+    if (state->error) state->error->index = position;
+    if (!result) return false;
+    if (!clags__finish(state)) return false;
+    if (state->exit) return true;
+    clags_spec_t *parent = state->parent;
+    if (parent && parent->fallbacks){
+        bool *seen = state->seen;
+        state->seen = state->parent_seen;
+        bool applied = clags__fallback(state, parent->args, parent->arg_count, parent->env_index, parent->env_mask);
+        state->seen = seen;
+        if (!applied) return false;
+    }
+    clags_spec_t *spec = state->spec;
+    if (!spec->fallbacks) return true;
+    return clags__fallback(state, spec->args, spec->arg_count, spec->env_index, spec->env_mask);
+}
+
+bool clags__run(clags__state_t *state, int argc, char **argv)
+{
+    clags_spec_t *spec = state->spec;
+    bool seen[spec->fallbacks? spec->arg_count:1];
+    if (spec->fallbacks && state->seen == NULL){
+        memset(seen, 0, sizeof(seen));
+        state->seen = seen;
+    }
+    // the table of a selected command, unless it is too large for this buffer and taken from the allocator
+    clags__align_t command_buffer[CLAGS_COMMAND_BUFFER_SIZE/sizeof(clags__align_t)];
+    state->command_memory = command_buffer;
+    if (spec->lazy && !state->validate_only) clags__lazy_reset(spec->args, spec->arg_count);
+    bool result = clags__run_tokens(state, argc, argv);
+    if (state->command_size) clags__free(state->allocator, state->command_memory, state->command_size);
+    state->command_memory = NULL;
+    state->command_size = 0;
+    if (state->command){
+        state->spec = spec;
+        state->parent = NULL;
+    }
+    return result;
+}
+
+bool clags__parse_with(int argc, char **argv, char *line, clags_spec_t *spec, const clags_settings_t *settings)
+{
+    clags__state_t state = {.spec=spec, .response_files=line == NULL, .env=true, .line=line};
+    if (settings){
+        state.allocator = settings->allocator;
+        state.files = settings->files;
+        state.response_files = line == NULL && !settings->no_response_files;
+        state.config = settings->config;
+        state.env = !settings->no_env;
+        state.stats = settings->stats;
+        state.trace = settings->trace;
+        state.trace_ctx = settings->trace_ctx;
+        state.error = settings->error;
+        state.threads = settings->threads;
+    }
+#ifdef CLAGS_STATS
+    uint64_t start = clags__now();
+    uint64_t converted = 0;
+    if (state.stats){
+        // the table was compiled once, so only the first parse collecting statistics pays for it
+        state.stats->sort_ns += spec->compile_ns;
+        spec->compile_ns = 0;
+        converted = state.stats->verify_ns + state.stats->custom_ns;
+    }
+#endif
+    bool result = clags__run(&state, argc, argv);
+    if (settings && settings->command) *settings->command = state.command;
+#ifdef CLAGS_STATS
+    if (state.stats){
+        uint64_t total = clags__now() - start;
+        uint64_t converting = state.stats->verify_ns + state.stats->custom_ns - converted;
+        state.stats->match_ns += total > converting? total - converting:0;
+    }
+#endif
+    return result;
+}
+
+bool clags_parse_with(int argc, char **argv, clags_spec_t *spec, const clags_settings_t *settings)
+{
+    return clags__parse_with(argc, argv, NULL, spec, settings);
+}
+
+// parses a command line without a program name, e.g. from a control socket, by splitting it in place with
+// the quoting rules of response files; errors index the tokens from 0, and response files are never opened
+bool clags_parse_line(clags_spec_t *spec, char *line, const clags_settings_t *settings)
+{
+    return clags__parse_with(0, NULL, line, spec, settings);
+}
+
+bool clags__resolve(clags_lazy_t *lazy, clags_error_t *error)
+{
+    if (!lazy->pending) return true;
+    if (error) *error = (clags_error_t){Clags_Error_None};
+    if (!clags__verify_funcs[lazy->type](lazy->name, lazy->token, lazy->value, lazy->func, error)) return false;
+    lazy->pending = false;
+    return true;
+}
+
+// converts a lazy argument on first access and returns its variable, or NULL if the value is invalid;
+// a failed conversion is reported like a parse error without an index and tried again on the next access
+void *clags_lazy_value(clags_lazy_t *lazy, clags_error_t *error)
+{
+    return clags__resolve(lazy, error)? lazy->value:NULL;
+}
+
+bool clags__force(clags_arg_t *args, size_t arg_count, clags_error_t *error)
+{
+    for (size_t i=0; i<arg_count; ++i){
+        clags_arg_t *arg = &args[i];
+        if (arg->type == Clags_Command && arg->cmd.value && *arg->cmd.value && !clags__force(arg->cmd.args, arg->cmd.arg_count, error)) return false;
+        clags_lazy_t *lazy = clags__lazy(arg);
+        if (lazy && !clags__resolve(lazy, error)) return false;
+    }
+    return true;
+}
+
+// converts every lazy argument that is still pending, in table order, and stops at the first invalid value
+bool clags_force_all(clags_spec_t *spec, clags_error_t *error)
+{
+    return clags__force(spec->args, spec->arg_count, error);
+}
+
+// the variable an argument writes to, its size and how its values compare
+typedef struct{
+    void *value;
+    size_t size;  // 0 if the argument cannot be reconfigured
+    clags_value_type_t type;
+    bool is_list;
+    const char *name;
+    clags_change_func_t on_change;
+} clags__target_t;
+
+size_t clags__type_size(clags_value_type_t type, size_t custom_size)
+{
+    switch(type){
+        case Clags_None:   return sizeof(char*);
+        case Clags_Custom: return custom_size;
+        case Clags_Bool:   return sizeof(bool);
+        case Clags_Int8:   return sizeof(int8_t);
+        case Clags_UInt8:  return sizeof(uint8_t);
+        case Clags_Int32:  return sizeof(int32_t);
+        case Clags_UInt32: return sizeof(uint32_t);
+        case Clags_Double: return sizeof(double);
+        default: {
+            assert(0 && "Unreachable");
+        }
+    }
+    return 0;
+}
+
+clags__target_t clags__target(clags_arg_t *arg)
+{
+    switch(arg->type){
+        case Clags_Required:{
+            clags_req_t req = arg->req;
+            size_t size = req.is_stream? 0:req.is_list? sizeof(clags_list_t):clags__type_size(req.value_type, req.value_size);
+            return (clags__target_t){.value=req.value, .size=size, .type=req.value_type, .is_list=req.is_list, .name=req.name, .on_change=req.on_change};
+        }
+        case Clags_Optional:{
+            clags_opt_t opt = arg->opt;
+            size_t size = opt.is_list? sizeof(clags_list_t):clags__type_size(opt.value_type, opt.value_size);
+            return (clags__target_t){.value=opt.value, .size=size, .type=opt.value_type, .is_list=opt.is_list, .name=opt.long_flag? opt.long_flag:opt.short_flag, .on_change=opt.on_change};
+        }
+        case Clags_Flag:
+            return (clags__target_t){.value=arg->flag.value, .size=sizeof(bool), .type=Clags_Bool, .name=arg->flag.long_flag? arg->flag.long_flag:arg->flag.short_flag, .on_change=arg->flag.on_change};
+        default:
+            return (clags__target_t){0};
+    }
+}
+
+void clags__retarget(clags_arg_t *arg, void *value)
+{
+    switch(arg->type){
+        case Clags_Required: arg->req.value = value;          break;
+        case Clags_Optional: arg->opt.value = value;          break;
+        case Clags_Flag:     arg->flag.value = (bool*) value; break;
+        default: break;
+    }
+}
+
+bool clags__same_value(clags__target_t target, const void *a, const void *b)
+{
+    if (target.is_list){
+        const clags_list_t *x = (const clags_list_t*) a, *y = (const clags_list_t*) b;
+        if (x->count != y->count) return false;
+        if (target.type != Clags_None) return x->count == 0 || memcmp(x->items, y->items, x->count*x->item_size) == 0;
+        for (size_t i=0; i<x->count; ++i){
+            if (strcmp(((char**) x->items)[i], ((char**) y->items)[i]) != 0) return false;
+        }
+        return true;
+    }
+    if (target.type == Clags_None){
+        const char *x = *(char *const*) a, *y = *(char *const*) b;
+        return x == y || (x && y && strcmp(x, y) == 0);
+    }
+    return memcmp(a, b, target.size) == 0;
+}
+
+void clags__swap(void *a, void *b, size_t size)
+{
+    unsigned char *x = (unsigned char*) a, *y = (unsigned char*) b;
+    for (size_t i=0; i<size; ++i){
+        unsigned char t = x[i];
+        x[i] = y[i];
+        y[i] = t;
+    }
+}
+
+// releases a shadow list: fixed shadow lists own a copy of the buffer of the fixed target list
+void clags__release_shadow(const clags_allocator_t *allocator, clags_list_t *list)
+{
+    if (list->fixed){
+        clags__free(allocator, list->items, list->capacity*list->item_size);
+        clags__free_copies(list);
+    } else{
+        clags_list_free(list);
+    }
+}
+
+// parses argv into shadow copies of all targets and, only if that succeeds, applies the values that changed;
+// options missing from argv keep their current value, flags missing from argv are reset to false
+bool clags_reconfigure(int argc, char **argv, clags_spec_t *spec, const clags_settings_t *settings)
+{
+    clags_error_t *error = settings? settings->error:NULL;
+    if (spec->command_count){
+        clags__report(error, Clags_Error_Input, "Tables with commands cannot be reconfigured!");
+        return false;
+    }
+    size_t count = spec->arg_count;
+    size_t align = sizeof(clags__align_t);
+    size_t slots_size = 0;
+    for (size_t i=0; i<count; ++i){
+        clags__target_t target = clags__target(&spec->args[i]);
+        if (target.size == 0){
+            clags__report(error, Clags_Error_Input, "Argument '%s' cannot be reconfigured%s!", target.name,
+                          spec->args[i].type == Clags_Required && spec->args[i].req.is_stream? ", as it is a stream":" without a value_size");
+            return false;
+        }
+        slots_size += (target.size + align-1) & ~(align-1);
+    }
+    size_t args_size = (count*sizeof(clags_arg_t) + align-1) & ~(align-1);
+    size_t size = args_size + slots_size + count*sizeof(bool);
+    const clags_allocator_t *allocator = settings? settings->allocator:NULL;
+    char *memory = (char*) clags__alloc(allocator, size);
+    if (memory == NULL){
+        clags__report(error, Clags_Error_Memory, "Failed to allocate memory for the reconfiguration!");
+        return false;
+    }
+    memset(memory, 0, size);
+
+    // a copy of the table writing into the slots, with empty shadow lists
+    clags_arg_t *shadow = (clags_arg_t*) memory;
+    void *slots[count+1];
+    char *slot = memory + args_size;
+    bool result = true;
+    for (size_t i=0; i<count; ++i){
+        clags__target_t target = clags__target(&spec->args[i]);
+        shadow[i] = spec->args[i];
+        slots[i] = slot;
+        slot += (target.size + align-1) & ~(align-1);
+        clags__retarget(&shadow[i], slots[i]);
+        // the shadow table converts right away, the lazy record is settled once the values are applied
+        if (shadow[i].type == Clags_Required) shadow[i].req.lazy = NULL;
+        if (shadow[i].type == Clags_Optional) shadow[i].opt.lazy = NULL;
+        if (!target.is_list) continue;
+        clags_list_t *list = (clags_list_t*) target.value, *copy = (clags_list_t*) slots[i];
+        *copy = (clags_list_t){.item_size=list->item_size};
+        if (list->fixed){
+            copy->items = clags__alloc(allocator, list->capacity*list->item_size);
+            copy->capacity = list->capacity;
+            copy->fixed = true;
+            if (copy->items == NULL && list->capacity) result = false;
+        }
+    }
+    bool *seen = (bool*) slot;
+
+    clags_spec_t shadow_spec;
+    if (result) result = clags__compile(&shadow_spec, shadow, count, allocator);
+    if (result){
+        clags__state_t state = {.spec=&shadow_spec, .response_files=true, .env=true, .seen=seen};
+        if (settings){
+            state.allocator = settings->allocator;
+            state.files = settings->files;
+            state.response_files = !settings->no_response_files;
+            state.config = settings->config;
+            state.env = !settings->no_env;
+            state.stats = settings->stats;
+            state.trace = settings->trace;
+            state.trace_ctx = settings->trace_ctx;
+            state.error = settings->error;
+            state.threads = settings->threads;
+        }
+        result = clags__run(&state, argc, argv);
+        for (size_t i=0; i<state.required_found && i<spec->required_count; ++i){
+            seen[shadow_spec.required[i] - shadow] = true;
+        }
+        clags_spec_free(&shadow_spec);
+    } else{
+        clags__report(error, Clags_Error_Memory, "Failed to allocate memory for the reconfiguration!");
+    }
+
+    // everything is validated, so applying the changes cannot fail anymore
+    bool changed[count+1];
+    for (size_t i=0; i<count; ++i){
+        clags__target_t target = clags__target(&spec->args[i]);
+        bool given = spec->args[i].type == Clags_Flag || seen[i];
+        changed[i] = result && target.value && given && !clags__same_value(target, target.value, slots[i]);
+        clags_lazy_t *lazy = clags__lazy(&spec->args[i]);
+        if (lazy && result && given) lazy->pending = false;
+        if (!changed[i]) continue;
+        clags_list_t *list = (clags_list_t*) target.value, *copy = (clags_list_t*) slots[i];
+        if (target.is_list && list->fixed){
+            size_t items = list->count > copy->count? list->count:copy->count;
+            clags__swap(list->items, copy->items, items*list->item_size);
+            clags__swap(&list->count, &copy->count, sizeof(list->count));
+            clags__swap(&list->copies, &copy->copies, sizeof(list->copies));
+        } else{
+            clags__swap(target.value, slots[i], target.size);
+        }
+    }
+    for (size_t i=0; i<count; ++i){
+        clags__target_t target = clags__target(&spec->args[i]);
+        if (changed[i] && target.on_change) target.on_change(target.name, target.value, slots[i]);
+        if (target.is_list) clags__release_shadow(allocator, (clags_list_t*) slots[i]);
+    }
+    clags__free(allocator, memory, size);
+    return result;
+}
+
+bool clags__output_write(clags_output_t *output, const char *data, size_t size);
+
+#define CLAGS__SNAPSHOT_MAGIC "CLAGSNAP"
+#define CLAGS__SNAPSHOT_BYTE_ORDER 0x01020304u
+
+typedef struct{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t spec_hash;
+    uint64_t size;
+    uint64_t arg_count;
+} clags__snapshot_header_t;
+
+uint64_t clags__hash64(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char*) data;
+    for (size_t i=0; i<size; ++i){
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t clags__hash64_string(uint64_t hash, const char *str)
+{
+    if (str) hash = clags__hash64(hash, str, strlen(str));
+    return clags__hash64(hash, "", 1);
+}
+
+uint64_t clags__args_hash(uint64_t hash, clags_arg_t *args, size_t arg_count)
+{
+    hash = clags__hash64(hash, &arg_count, sizeof(arg_count));
+    for (size_t i=0; i<arg_count; ++i){
+        clags_arg_t *arg = &args[i];
+        clags__target_t target = clags__target(arg);
+        uint32_t layout[] = {(uint32_t) arg->type, (uint32_t) target.type, target.is_list, (uint32_t) target.size,
+                             arg->type == Clags_Required && arg->req.is_stream};
+        hash = clags__hash64(hash, layout, sizeof(layout));
+        switch(arg->type){
+            case Clags_Required: hash = clags__hash64_string(hash, arg->req.name); break;
+            case Clags_Optional:
+                hash = clags__hash64_string(hash, arg->opt.short_flag);
+                hash = clags__hash64_string(hash, arg->opt.long_flag);
+                break;
+            case Clags_Flag:
+                hash = clags__hash64_string(hash, arg->flag.short_flag);
+                hash = clags__hash64_string(hash, arg->flag.long_flag);
+                break;
+            case Clags_Command:
+                hash = clags__hash64_string(hash, arg->cmd.name);
+                hash = clags__args_hash(hash, arg->cmd.args, arg->cmd.arg_count);
+                break;
+        }
+    }
+    return hash;
+}
+
+// hashes the layout of the table and all command tables, i.e. everything a snapshot depends on, but no addresses
+uint64_t clags__spec_hash(clags_spec_t *spec)
+{
+    return clags__args_hash(14695981039346656037ull, spec->args, spec->arg_count);
+}
+
+// appends to data, or only counts the length while data is NULL
+typedef struct{
+    char *data;
+    size_t length;
+} clags__writer_t;
+
+void clags__put(clags__writer_t *writer, const void *data, size_t size)
+{
+    if (writer->data && size) memcpy(writer->data+writer->length, data, size);
+    writer->length += size;
+}
+
+void clags__put_string(clags__writer_t *writer, const char *str)
+{
+    uint32_t length = str? (uint32_t) strlen(str):UINT32_MAX;
+    clags__put(writer, &length, sizeof(length));
+    if (str) clags__put(writer, str, length+1);
+}
+
+// a selected command is followed by the targets of its own table
+void clags__snapshot_write_args(clags__writer_t *writer, clags_arg_t *args, size_t arg_count)
+{
+    for (size_t i=0; i<arg_count; ++i){
+        clags_arg_t *arg = &args[i];
+        if (arg->type == Clags_Command){
+            bool selected = arg->cmd.value && *arg->cmd.value;
+            clags__put(writer, &selected, sizeof(selected));
+            if (selected) clags__snapshot_write_args(writer, arg->cmd.args, arg->cmd.arg_count);
+            continue;
+        }
+        clags__target_t target = clags__target(arg);
+        if (target.size == 0) continue;
+        if (target.is_list){
+            clags_list_t empty = {0};
+            const clags_list_t *list = target.value? (const clags_list_t*) target.value:&empty;
+            uint64_t layout[] = {list->count, list->item_size};
+            clags__put(writer, layout, sizeof(layout));
+            if (target.type != Clags_None){
+                clags__put(writer, list->items, list->count*list->item_size);
+            } else{
+                for (size_t j=0; j<list->count; ++j) clags__put_string(writer, ((char**) list->items)[j]);
+            }
+        } else if (target.type == Clags_None){
+            clags__put_string(writer, target.value? *(char**) target.value:NULL);
+        } else if (target.value){
+            clags__put(writer, target.value, target.size);
+        } else{
+            uint64_t zero[8] = {0};
+            for (size_t left=target.size; left; ){
+                size_t n = left < sizeof(zero)? left:sizeof(zero);
+                clags__put(writer, zero, n);
+                left -= n;
+            }
+        }
+    }
+}
+
+void clags__snapshot_write(clags__writer_t *writer, clags_spec_t *spec)
+{
+    clags__snapshot_header_t header = {.version=CLAGS_SNAPSHOT_VERSION, .byte_order=CLAGS__SNAPSHOT_BYTE_ORDER,
+                                       .spec_hash=clags__spec_hash(spec), .arg_count=spec->arg_count};
+    memcpy(header.magic, CLAGS__SNAPSHOT_MAGIC, sizeof(header.magic));
+    size_t start = writer->length;
+    clags__put(writer, &header, sizeof(header));
+    clags__snapshot_write_args(writer, spec->args, spec->arg_count);
+    if (writer->data){
+        header.size = writer->length - start;
+        memcpy(writer->data+start, &header, sizeof(header));
+    }
+}
+
+bool clags__snapshot_check(clags_arg_t *args, size_t arg_count, clags_error_t *error)
+{
+    for (size_t i=0; i<arg_count; ++i){
+        clags_arg_t *arg = &args[i];
+        if (arg->type == Clags_Command){
+            if (arg->cmd.value && *arg->cmd.value && !clags__snapshot_check(arg->cmd.args, arg->cmd.arg_count, error)) return false;
+            continue;
+        }
+        if (!(arg->type == Clags_Required && arg->req.is_stream) && clags__target(arg).size == 0){
+            clags__report(error, Clags_Error_Input, "Argument '%s' cannot be saved without a value_size!", clags__target(arg).name);
+            return false;
+        }
+    }
+    return true;
+}
+
+// writes the values of all targets, including those of the selected commands, as a snapshot, which
+// clags_snapshot_load restores with the same table; custom values are copied byte for byte, so they
+// have to be plain data without pointers
+bool clags_snapshot_save(clags_spec_t *spec, clags_output_t *output, clags_error_t *error)
+{
+    if (error) *error = (clags_error_t){Clags_Error_None};
+    if (spec->lazy && !clags_force_all(spec, error)) return false;
+    if (!clags__snapshot_check(spec->args, spec->arg_count, error)) return false;
+    clags__writer_t writer = {0};
+    clags__snapshot_write(&writer, spec);
+    size_t size = writer.length;
+    writer = (clags__writer_t){.data=(char*) clags__alloc(&spec->allocator, size)};
+    if (writer.data == NULL){
+        clags__report(error, Clags_Error_Memory, "Failed to allocate memory for the snapshot!");
+        return false;
+    }
+    clags__snapshot_write(&writer, spec);
+    bool result = clags__output_write(output, writer.data, size);
+    clags__free(&spec->allocator, writer.data, size);
+    if (!result) clags__report(error, Clags_Error_Input, "Failed to write the snapshot!");
+    return result;
+}
+
+typedef struct{
+    const char *data;
+    size_t size;
+    size_t offset;
+} clags__reader_t;
+
+// copies the next size bytes to dst, which may be NULL to only check that they exist
+bool clags__take(clags__reader_t *reader, void *dst, size_t size)
+{
+    if (size > reader->size - reader->offset) return false;
+    if (dst && size) memcpy(dst, reader->data+reader->offset, size);
+    reader->offset += size;
+    return true;
+}
+
+bool clags__take_string(clags__reader_t *reader, char **str)
+{
+    uint32_t length;
+    if (!clags__take(reader, &length, sizeof(length))) return false;
+    if (length == UINT32_MAX){
+        *str = NULL;
+        return true;
+    }
+    if ((size_t)length >= reader->size - reader->offset || reader->data[reader->offset+length] != '\0') return false;
+    *str = (char*) reader->data + reader->offset;
+    reader->offset += (size_t)length+1;
+    return true;
+}
+
+// reading a bool that holds anything but 0 or 1 is undefined, so such bytes mark a corrupted snapshot
+bool clags__valid_bools(const clags__reader_t *reader, size_t count)
+{
+    if (count > (reader->size - reader->offset)/sizeof(bool)) return true;  // left to clags__take
+    const unsigned char *bytes = (const unsigned char*) reader->data + reader->offset;
+    for (size_t i=0; i<count*sizeof(bool); ++i){
+        if (bytes[i] > 1) return false;
+    }
+    return true;
+}
+
+// walks a snapshot, first only checking it and reserving list space, then, with apply set, writing the targets,
+// which cannot fail anymore
+bool clags__snapshot_read(clags__state_t *state, clags__reader_t *reader, clags_arg_t *args, size_t arg_count, bool apply)
+{
+    for (size_t i=0; i<arg_count; ++i){
+        clags_arg_t *arg = &args[i];
+        if (arg->type == Clags_Command){
+            bool selected;
+            if (!clags__valid_bools(reader, 1) || !clags__take(reader, &selected, sizeof(selected))) return false;
+            if (apply && arg->cmd.value) *arg->cmd.value = selected;
+            if (selected && !clags__snapshot_read(state, reader, arg->cmd.args, arg->cmd.arg_count, apply)) return false;
+            continue;
+        }
+        clags__target_t target = clags__target(arg);
+        if (target.size == 0) continue;
+        clags_lazy_t *lazy = clags__lazy(arg);
+        if (apply && lazy) lazy->pending = false;
+        if (target.is_list){
+            uint64_t layout[2];
+            if (!clags__take(reader, layout, sizeof(layout))) return false;
+            clags_list_t *list = (clags_list_t*) target.value;
+            size_t count = (size_t) layout[0];
+            if (list && layout[1] != list->item_size) return false;
+            if (list && list->fixed && count > list->capacity){
+                clags__report(state->error, Clags_Error_ListFull, "Too many values for list argument '%s' (maximum %zu)!", target.name, list->capacity);
+                return false;
+            }
+            if (list && !apply){
+                // growing keeps the current items, so a later failure still changes nothing
+                size_t kept = list->count;
+                list->count = 0;
+                bool reserved = clags__list_reserve(state, list, target.name, count);
+                list->count = kept;
+                if (!reserved) return false;
+            }
+            if (apply && list) list->count = count;
+            if (target.type == Clags_Bool && !clags__valid_bools(reader, count)) return false;
+            if (target.type != Clags_None){
+                if (layout[1] && count > (reader->size - reader->offset)/layout[1]) return false;
+                if (!clags__take(reader, apply && list? list->items:NULL, count*(size_t)layout[1])) return false;
+            } else{
+                for (size_t j=0; j<count; ++j){
+                    char *item;
+                    if (!clags__take_string(reader, &item)) return false;
+                    if (apply && list) ((char**) list->items)[j] = item;
+                }
+            }
+        } else if (target.type == Clags_None){
+            char *str;
+            if (!clags__take_string(reader, &str)) return false;
+            if (apply && target.value) *(char**) target.value = str;
+        } else if ((target.type == Clags_Bool && !clags__valid_bools(reader, 1)) || !clags__take(reader, apply? target.value:NULL, target.size)){
+            return false;
+        }
+    }
+    return true;
+}
+
+// restores the targets from a snapshot made with the same table; string values point into data afterwards,
+// nothing is written unless the whole snapshot is valid
+bool clags_snapshot_load(clags_spec_t *spec, const void *data, size_t size, const clags_settings_t *settings)
+{
+    clags__state_t state = {.spec=spec};
+    if (settings){
+        state.allocator = settings->allocator;
+        state.error = settings->error;
+    }
+    if (state.error) *state.error = (clags_error_t){Clags_Error_None};
+    clags__snapshot_header_t header;
+    clags__reader_t reader = {.data=(const char*) data, .size=size};
+    if (!clags__take(&reader, &header, sizeof(header)) || memcmp(header.magic, CLAGS__SNAPSHOT_MAGIC, sizeof(header.magic)) != 0){
+        clags__report(state.error, Clags_Error_Input, "Not a clags snapshot!");
+        return false;
+    }
+    if (header.version != CLAGS_SNAPSHOT_VERSION || header.byte_order != CLAGS__SNAPSHOT_BYTE_ORDER){
+        clags__report(state.error, Clags_Error_Input, "Unsupported snapshot version %u!", header.version);
+        return false;
+    }
+    if (header.spec_hash != clags__spec_hash(spec) || header.arg_count != spec->arg_count){
+        clags__report(state.error, Clags_Error_Input, "Snapshot was made from a different argument table!");
+        return false;
+    }
+    if (header.size != size){
+        clags__report(state.error, Clags_Error_Input, "Truncated snapshot (%zu of %llu bytes)!", size, (unsigned long long) header.size);
+        return false;
+    }
+    size_t start = reader.offset;
+    if (!clags__snapshot_read(&state, &reader, spec->args, spec->arg_count, false) || reader.offset != reader.size){
+        if (state.error == NULL || state.error->code == Clags_Error_None) clags__report(state.error, Clags_Error_Input, "Corrupted snapshot!");
+        return false;
+    }
+    reader.offset = start;
+    return clags__snapshot_read(&state, &reader, spec->args, spec->arg_count, true);
+}
+
+// loads a snapshot from a file, e.g. "/proc/self/fd/N" for an inherited memfd; the file stays mapped,
+// as string values point into it, until the files collected in settings are released
+bool clags_snapshot_load_file(clags_spec_t *spec, const char *path, const clags_settings_t *settings)
+{
+    const clags_allocator_t *allocator = settings? settings->allocator:NULL;
+    clags_files_t *files = settings? settings->files:NULL;
+    clags__mapping_t *mapping = files? (clags__mapping_t*) clags__alloc(allocator, sizeof(*mapping)):NULL;
+    char *data;
+    size_t size;
+    bool mapped;
+    if ((files && mapping == NULL) || !clags__load_file(allocator, path, &data, &size, &mapped)){
+        if (mapping) clags__free(allocator, mapping, sizeof(*mapping));
+        clags__report(settings? settings->error:NULL, Clags_Error_Input, "Could not read snapshot '%s'!", path);
+        return false;
+    }
+    if (!clags_snapshot_load(spec, data, size, settings)){
+        clags__unload_file(allocator, data, size, mapped);
+        if (mapping) clags__free(allocator, mapping, sizeof(*mapping));
+        return false;
+    }
+    if (mapping){
+        *mapping = (clags__mapping_t){.next=files->head, .allocator=clags__keep_allocator(allocator), .data=data, .size=size, .mapped=mapped};
+        files->head = mapping;
+    }
+    return true;
+}
+
+typedef struct{
+    clags_spec_t *spec;
+    const int *argcs;
+    char ***argvs;
+    clags_error_t *errors;
+    const clags_settings_t *settings;
+} clags__batch_t;
+
+void clags__batch_task(void *ctx, size_t index)
+{
+    clags__batch_t *batch = (clags__batch_t*) ctx;
+    clags__state_t state = {.spec=batch->spec, .response_files=true, .error=&batch->errors[index], .validate_only=true, .env=true};
+    if (batch->settings){
+        state.allocator = batch->settings->allocator;
+        state.response_files = !batch->settings->no_response_files;
+        state.config = batch->settings->config;
+        state.env = !batch->settings->no_env;
+    }
+    clags__run(&state, batch->argcs[index], batch->argvs[index]);
+}
+
+// validates count argument vectors against one spec in parallel, without writing to any target;
+// errors[i] receives the result of argvs[i], and true is returned if all of them are valid
+bool clags_parse_batch(clags_spec_t *spec, size_t count, const int *argcs, char ***argvs, clags_error_t *errors, const clags_settings_t *settings)
+{
+    clags__batch_t batch = {.spec=spec, .argcs=argcs, .argvs=argvs, .errors=errors, .settings=settings};
+    clags__parallel_for(count, settings? settings->threads:0, clags__batch_task, &batch);
+    for (size_t i=0; i<count; ++i){
+        if (errors[i].code != Clags_Error_None) return false;
+    }
+    return true;
+}
+
+void clags_files_free(clags_files_t *files)
+{
+    while (files->head){
+        clags__mapping_t *mapping = files->head;
+        files->head = mapping->next;
+        clags__unload_file(&mapping->allocator, mapping->data, mapping->size, mapping->mapped);
+        clags__free(&mapping->allocator, mapping, sizeof(*mapping));
+    }
+}
+
+bool clags__is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// splits every "key = value" line in place; the value is trimmed and may be quoted, later keys override earlier ones
+bool clags__config_index(clags_config_t *config, const char *path)
+{
+    char *cursor = config->data, *end = config->data+config->size;
+    size_t line = 0;
+    while (cursor < end){
+        line++;
+        char *eol = (char*) memchr(cursor, '\n', end-cursor);
+        if (eol == NULL) eol = end;
+        char *start = cursor, *stop = eol;
+        cursor = eol < end? eol+1:end;
+        while (start < stop && clags__is_space(*start)) start++;
+        while (stop > start && clags__is_space(stop[-1])) stop--;
+        if (start == stop || *start == '#' || *start == ';') continue;
+
+        char *equals = (char*) memchr(start, '=', stop-start);
+        char *key_end = equals;
+        while (key_end && key_end > start && clags__is_space(key_end[-1])) key_end--;
+        if (equals == NULL || key_end == start){
+            clags__report(NULL, Clags_Error_Input, "Invalid line %zu in config file '%s'!", line, path);
+            return false;
+        }
+        char *value = equals+1;
+        while (value < stop && clags__is_space(*value)) value++;
+        if (stop-value >= 2 && (*value == '"' || *value == '\'') && stop[-1] == *value){
+            value++;
+            stop--;
+        }
+        *stop = '\0';
+
+        uint32_t length = (uint32_t)(key_end-start);
+        uint32_t hash = clags__hash(start, length);
+        for (size_t i=hash&config->index_mask;; i=(i+1)&config->index_mask){
+            clags__config_entry_t *entry = &config->index[i];
+            if (entry->key == NULL || (entry->hash == hash && entry->length == length && memcmp(entry->key, start, length) == 0)){
+                *entry = (clags__config_entry_t){.key=start, .hash=hash, .length=length, .value=value};
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool clags_config_load(clags_config_t *config, const char *path, const clags_allocator_t *allocator)
+{
+    *config = (clags_config_t){.allocator=clags__keep_allocator(allocator)};
+    if (!clags__load_file(allocator, path, &config->data, &config->size, &config->mapped)){
+        clags__report(NULL, Clags_Error_Input, "Could not read config file '%s'!", path);
+        return false;
+    }
+    size_t lines = 1;
+    for (char *p=config->data, *end=config->data+config->size; (p = (char*) memchr(p, '\n', end-p)) != NULL; ++p) lines++;
+    size_t capacity = 4;
+    while (capacity < lines*2) capacity *= 2;
+    config->index = (clags__config_entry_t*) clags__alloc(allocator, capacity*sizeof(*config->index));
+    if (config->index == NULL){
+        clags__report(NULL, Clags_Error_Memory, "Failed to allocate memory for config file '%s'!", path);
+        clags_config_free(config);
+        return false;
+    }
+    memset(config->index, 0, capacity*sizeof(*config->index));
+    config->index_mask = capacity-1;
+    if (!clags__config_index(config, path)){
+        clags_config_free(config);
+        return false;
+    }
+    return true;
+}
+
+const char *clags_config_get(const clags_config_t *config, const char *key)
+{
+    return clags__config_find(config, key, strlen(key));
+}
+
+void clags_config_free(clags_config_t *config)
+{
+    if (config->index) clags__free(&config->allocator, config->index, (config->index_mask+1)*sizeof(*config->index));
+    if (config->data) clags__unload_file(&config->allocator, config->data, config->size, config->mapped);
+    *config = (clags_config_t){0};
+}
+
+bool clags__parse(int argc, char **argv, clags_arg_t *args, size_t arg_count)
+{
+    void *memory[clags__spec_size(args, arg_count)/sizeof(void*) + 1];
+    clags_spec_t spec;
+    clags__spec_init(&spec, args, arg_count, memory);
+    return clags_parse_spec(argc, argv, &spec);
+}
+
+typedef struct{
+    char *data;
+    size_t capacity;
+    size_t length;
+} clags__text_t;
+
+void clags__textf(clags__text_t *text, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    size_t remaining = text->length < text->capacity? text->capacity - text->length:0;
+    int written = vsnprintf(remaining? text->data+text->length:NULL, remaining, fmt, args);
+    va_end(args);
+    if (written > 0) text->length += (size_t)written;
+}
+
+bool clags__output_write(clags_output_t *output, const char *data, size_t size)
+{
+    switch(output->kind){
+        case Clags_Output_Buffer:{
+            size_t remaining = output->length < output->capacity? output->capacity - output->length:0;
+            if (remaining){
+                size_t n = size < remaining? size:remaining-1;
+                memcpy(output->buffer+output->length, data, n);
+                output->buffer[output->length+n] = '\0';
+            }
+            output->length += size;
+            return output->length < output->capacity;
+        }
+        case Clags_Output_File:
+            return fwrite(data, 1, size, output->file) == size;
+        case Clags_Output_Fd:
+#ifdef CLAGS__POSIX
+            while (size){
+                ssize_t written = write(output->fd, data, size);
+                if (written < 0){
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                data += written;
+                size -= (size_t)written;
+            }
+            return true;
+#else
+            return false;
+#endif
+        case Clags_Output_Func:
+            return output->func(output->ctx, data, size);
+        default:{
+            assert(0 && "Unreachable");
+        }
+    }
+    return false;
+}
+
+void clags__print_option_type(clags__text_t *text, clags_opt_t opt)
+{
+    if (opt.is_list){
+        const char *type = clags__type_names[opt.value_type];
+        clags__textf(text, " (%s%s'%c' separated)", type? type:"", type? "[], ":"", opt.separator? opt.separator:CLAGS_LIST_SEPARATOR);
+    } else if (opt.value_type != Clags_None){
+        clags__textf(text, " (%s)", clags__type_names[opt.value_type]);
+    }
+    if (opt.env) clags__textf(text, " [env: %s]", opt.env);
+    if (opt.config_key) clags__textf(text, " [config: %s]", opt.config_key);
+}
+
+void clags__render_synopsis(clags__text_t *text, clags_spec_t *spec)
+{
+    if (spec->optional_count) clags__textf(text, " [OPTIONS]");
+    if (spec->flag_count) clags__textf(text, " [FLAGS]");
+    for (size_t i=0; i<spec->required_count; ++i){
+        clags__textf(text, " <%s%s>", spec->required[i]->req.name, spec->required[i]->req.is_list?"..":"");
+    }
+}
+
+void clags__render_arguments(clags__text_t *text, clags_spec_t *spec)
+{
+    if (spec->required_count == 0) return;
+    clags__textf(text, "  Arguments:\n");
+    for (size_t i=0; i<spec->required_count; ++i){
+        clags_req_t req = spec->required[i]->req;
+        clags__textf(text, "    %*s : %s", CLAGS_USAGE_ALIGNMENT, req.name, req.description);
+        if (req.value_type != Clags_None) clags__textf(text, " (%s%s)", clags__type_names[req.value_type], req.is_list?"[]":"");
+        clags__textf(text, "\n");
+    }
+}
+
+void clags__render_options(clags__text_t *text, const char *title, clags_spec_t *spec)
+{
+    if (spec->optional_count == 0) return;
+    clags__textf(text, "  %s:\n", title);
+    for (size_t i=0; i<spec->optional_count; ++i){
+        clags_opt_t opt = spec->optional[i]->opt;
+        if (opt.short_flag){
+            if (opt.long_flag){
+                size_t buf_size = strlen(opt.short_flag) + strlen(opt.long_flag) + (opt.field_name? strlen(opt.field_name):0) + 6;
+                char buf[buf_size];
+                snprintf(buf, buf_size, "%s, %s(=)%s>", opt.short_flag, opt.long_flag, opt.field_name);
+                clags__textf(text, "    %*s : %s", CLAGS_USAGE_ALIGNMENT, buf, opt.description);
+            } else{
+                clags__textf(text, "    %*s : %s", CLAGS_USAGE_ALIGNMENT, opt.short_flag, opt.description);
+            }
+            clags__print_option_type(text, opt);
+            clags__textf(text, "\n");
+        }else if (opt.long_flag){
+            size_t buf_size = strlen(opt.long_flag) + (opt.field_name? strlen(opt.field_name):0) + 4;
+            char buf[buf_size];
+            snprintf(buf, buf_size, "%s(=)%s", opt.long_flag, opt.field_name);
+            clags__textf(text, "    %*s : %s", CLAGS_USAGE_ALIGNMENT, buf, opt.description);
+            clags__print_option_type(text, opt);
+            clags__textf(text, "\n");
+        }
+    }
+}
+
+void clags__render_flags(clags__text_t *text, const char *title, clags_spec_t *spec)
+{
+    if (spec->flag_count == 0) return;
+    clags__textf(text, "  %s:\n", title);
+    for (size_t i=0; i<spec->flag_count; ++i){
+        clags_flag_t flag = spec->flags[i]->flag;
+        if (flag.short_flag){
+            if (flag.long_flag){
+                size_t buf_size = strlen(flag.short_flag) + strlen(flag.long_flag) + 12;
+                char buf[buf_size];
+                snprintf(buf, buf_size, "%s, %s", flag.short_flag, flag.long_flag);
+                clags__textf(text, "    %*s : %s\n", CLAGS_USAGE_ALIGNMENT, buf, flag.description);
+            } else{
+                clags__textf(text, "    %*s : %s\n", CLAGS_USAGE_ALIGNMENT, flag.short_flag, flag.description);
+            }
+        } else if (flag.long_flag){
+            clags__textf(text, "    %*s : %s\n", CLAGS_USAGE_ALIGNMENT, flag.long_flag, flag.description);
+        }
+    }
+}
+
+// renders the usage text, only counting the length past the capacity of text
+void clags__render_usage(clags__text_t *text, const char *program_name, clags_spec_t *spec)
+{
+    clags__textf(text, "Usage: %s", program_name);
+    clags__render_synopsis(text, spec);
+    if (spec->command_count) clags__textf(text, " COMMAND [ARGS]");
+    clags__textf(text, "\n");
+    
+    clags__render_arguments(text, spec);
+    clags__render_options(text, "Options", spec);
+    clags__render_flags(text, "Flags", spec);
+    if (spec->command_count){
+        clags__textf(text, "  Commands:\n");
+        for (size_t i=0; i<spec->command_count; ++i){
+            clags_cmd_t cmd = spec->commands[i]->cmd;
+            clags__textf(text, "    %*s : %s\n", CLAGS_USAGE_ALIGNMENT, cmd.name, cmd.description);
+        }
+    }
+}
+
+// renders the usage of one command, followed by the global options and flags it inherits
+void clags__render_command_usage(clags__text_t *text, const char *program_name, clags_spec_t *parent, const char *name, clags_spec_t *spec)
+{
+    clags__textf(text, "Usage: %s", program_name);
+    for (size_t i=0; i<parent->required_count; ++i){
+        clags__textf(text, " <%s%s>", parent->required[i]->req.name, parent->required[i]->req.is_list?"..":"");
+    }
+    clags__textf(text, " %s", name);
+    if (spec->optional_count || parent->optional_count) clags__textf(text, " [OPTIONS]");
+    if (spec->flag_count || parent->flag_count) clags__textf(text, " [FLAGS]");
+    for (size_t i=0; i<spec->required_count; ++i){
+        clags__textf(text, " <%s%s>", spec->required[i]->req.name, spec->required[i]->req.is_list?"..":"");
+    }
+    clags__textf(text, "\n");
+
+    clags__render_arguments(text, spec);
+    clags__render_options(text, "Options", spec);
+    clags__render_flags(text, "Flags", spec);
+    clags__render_options(text, "Global options", parent);
+    clags__render_flags(text, "Global flags", parent);
+}
+
+// returns the usage text of a compiled spec, rendering it again only when the program name changed
+const char *clags__usage_text(const char *program_name, clags_spec_t *spec, size_t *length)
+{
+    if (spec->memory == NULL) return NULL;
+    if (spec->usage && strcmp(spec->usage+spec->usage_length+1, program_name) == 0){
+        *length = spec->usage_length;
+        return spec->usage;
+    }
+    if (spec->usage) clags__free(&spec->allocator, spec->usage, spec->usage_size);
+    spec->usage = NULL;
+
+    clags__text_t text = {0};
+    clags__render_usage(&text, program_name, spec);
+    size_t name_length = strlen(program_name);
+    size_t size = text.length + name_length + 2;
+    text = (clags__text_t){.data=(char*) clags__alloc(&spec->allocator, size), .capacity=text.length+1};
+    if (text.data == NULL) return NULL;
+    clags__render_usage(&text, program_name, spec);
+    memcpy(text.data+text.length+1, program_name, name_length+1);
+
+    spec->usage = text.data;
+    spec->usage_length = text.length;
+    spec->usage_size = size;
+    *length = text.length;
+    return text.data;
+}
+
+bool clags_usage_output(const char *program_name, clags_spec_t *spec, clags_output_t *output)
+{
+    size_t length;
+    const char *cached = clags__usage_text(program_name, spec, &length);
+    if (cached) return clags__output_write(output, cached, length);
+
+    // specs that cannot hold a cache are rendered on the stack
+    clags__text_t text = {0};
+    clags__render_usage(&text, program_name, spec);
+    char buffer[text.length+1];
+    text = (clags__text_t){.data=buffer, .capacity=sizeof(buffer)};
+    clags__render_usage(&text, program_name, spec);
+    return clags__output_write(output, buffer, text.length);
+}
+
+// writes the usage to stdout in a single write, after anything the program already buffered
+void clags_usage_spec(const char *program_name, clags_spec_t *spec)
+{
+#ifdef CLAGS__POSIX
+    fflush(stdout);
+    clags_output_t output = clags_output_fd(STDOUT_FILENO);
+#else
+    clags_output_t output = clags_output_file(stdout);
+#endif
+    clags_usage_output(program_name, spec, &output);
+}
+
+bool clags_usage_command_output(const char *program_name, clags_spec_t *spec, const char *command, clags_output_t *output)
+{
+    clags_arg_t *arg = clags__index_lookup(spec, command, strlen(command), NULL);
+    if (arg == NULL || arg->type != Clags_Command){
+        fprintf(stderr, "[ERROR] Unknown command: '%s'!\n", command);
+        return false;
+    }
+    // only the requested command is compiled, on the stack
+    clags_cmd_t cmd = arg->cmd;
+    void *memory[clags__spec_size(cmd.args, cmd.arg_count)/sizeof(void*) + 1];
+    clags_spec_t command_spec;
+    clags__spec_init(&command_spec, cmd.args, cmd.arg_count, memory);
+
+    clags__text_t text = {0};
+    clags__render_command_usage(&text, program_name, spec, cmd.name, &command_spec);
+    char buffer[text.length+1];
+    text = (clags__text_t){.data=buffer, .capacity=sizeof(buffer)};
+    clags__render_command_usage(&text, program_name, spec, cmd.name, &command_spec);
+    return clags__output_write(output, buffer, text.length);
+}
+
+void clags_usage_command_spec(const char *program_name, clags_spec_t *spec, const char *command)
+{
+#ifdef CLAGS__POSIX
+    fflush(stdout);
+    clags_output_t output = clags_output_fd(STDOUT_FILENO);
+#else
+    clags_output_t output = clags_output_file(stdout);
+#endif
+    clags_usage_command_output(program_name, spec, command, &output);
+}
+
+void clags__usage_command(const char *program_name, clags_arg_t *args, size_t arg_count, const char *command)
+{
+    void *memory[clags__spec_size(args, arg_count)/sizeof(void*) + 1];
+    clags_spec_t spec;
+    clags__spec_init(&spec, args, arg_count, memory);
+    clags_usage_command_spec(program_name, &spec, command);
+}
+
+void clags__usage(const char *program_name, clags_arg_t *args, size_t arg_count)
+{
+    void *memory[clags__spec_size(args, arg_count)/sizeof(void*) + 1];
+    clags_spec_t spec;
+    clags__spec_init(&spec, args, arg_count, memory);
+    clags_usage_spec(program_name, &spec);
+}
+
+void clags__complete_write(clags_completion_t *completion, const char *data, size_t size)
+{
+    if (completion->length + size > sizeof(completion->buffer)){
+        if (!clags__output_write(completion->output, completion->buffer, completion->length)) completion->failed = true;
+        completion->length = 0;
+        if (size > sizeof(completion->buffer)){
+            if (!clags__output_write(completion->output, data, size)) completion->failed = true;
+            return;
+        }
+    }
+    memcpy(completion->buffer+completion->length, data, size);
+    completion->length += size;
+}
+
+// adds a candidate if it starts with the prefix, as a "candidate<TAB>description" line
+void clags_complete_add(clags_completion_t *completion, const char *candidate, const char *description)
+{
+    size_t length = strlen(completion->prefix);
+    if (strncmp(candidate, completion->prefix, length) != 0) return;
+    clags__complete_write(completion, completion->lead, completion->lead_length);
+    clags__complete_write(completion, candidate, strlen(candidate));
+    if (description && *description){
+        clags__complete_write(completion, "\t", 1);
+        clags__complete_write(completion, description, strlen(description));
+    }
+    clags__complete_write(completion, "\n", 1);
+}
+
+void clags__complete_value(clags_completion_t *completion, clags_complete_func_t complete, clags_value_type_t type, const char *field_name)
+{
+    if (complete){
+        complete(completion->prefix, completion);
+    } else if (type == Clags_Bool){
+        clags_complete_add(completion, "true", field_name);
+        clags_complete_add(completion, "false", field_name);
+    }
+}
+
+clags_arg_t *clags__complete_lookup(clags_spec_t *spec, clags_spec_t *parent, const char *word, size_t length)
+{
+    clags_arg_t *match = clags__index_lookup(spec, word, length, NULL);
+    if (match || parent == NULL) return match;
+    match = clags__index_lookup(parent, word, length, NULL);
+    return match && match->type != Clags_Command? match:NULL;
+}
+
+void clags__complete_flags(clags_completion_t *completion, clags_spec_t *spec, clags_spec_t *shadow)
+{
+    for (size_t i=0; i<spec->optional_count; ++i){
+        clags_opt_t opt = spec->optional[i]->opt;
+        const char *flags[] = {opt.short_flag, opt.long_flag};
+        for (size_t j=0; j<2; ++j){
+            if (flags[j] && (shadow == NULL || clags__index_lookup(shadow, flags[j], strlen(flags[j]), NULL) == NULL)){
+                clags_complete_add(completion, flags[j], opt.description);
+            }
+        }
+    }
+    for (size_t i=0; i<spec->flag_count; ++i){
+        clags_flag_t flag = spec->flags[i]->flag;
+        const char *flags[] = {flag.short_flag, flag.long_flag};
+        for (size_t j=0; j<2; ++j){
+            if (flags[j] && (shadow == NULL || clags__index_lookup(shadow, flags[j], strlen(flags[j]), NULL) == NULL)){
+                clags_complete_add(completion, flags[j], flag.description);
+            }
+        }
+    }
+}
+
+// follows the words in front of the cursor with one index lookup each, like clags__feed but without converting anything,
+// then adds the candidates for the current word
+void clags__complete_words(clags_completion_t *completion, clags_spec_t *spec, clags_spec_t *parent, char **words, size_t count, const char *current)
+{
+    clags_arg_t *pending = NULL;
+    size_t required_found = 0;
+    bool in_list = false;
+    for (size_t i=0; i<count; ++i){
+        const char *word = words[i];
+        if (pending){
+            pending = NULL;
+            continue;
+        }
+        if (strcmp(word, "--") == 0){
+            if (in_list) required_found++;
+            in_list = false;
+            continue;
+        }
+        clags_arg_t *match = clags__complete_lookup(spec, parent, word, strlen(word));
+        if (match && match->type == Clags_Command && required_found < spec->required_count) match = NULL;
+        if (match){
+            if (in_list) required_found++;
+            in_list = false;
+            if (match->type == Clags_Optional) pending = match;
+            if (match->type != Clags_Command) continue;
+
+            // only the selected command is compiled, on the stack
+            clags_cmd_t cmd = match->cmd;
+            void *memory[clags__spec_size(cmd.args, cmd.arg_count)/sizeof(void*) + 1];
+            clags_spec_t command;
+            clags__spec_init(&command, cmd.args, cmd.arg_count, memory);
+            if (command.command_count == 0) clags__complete_words(completion, &command, spec, words+i+1, count-i-1, current);
+            return;
+        }
+        // designated options, flag combinations and unknown options do not take the next word
+        if (word[0] == '-' && word[1] != '\0') continue;
+        if (required_found < spec->required_count){
+            if (spec->required[required_found]->req.is_list) in_list = true;
+            else required_found++;
+        }
+    }
+
+    if (pending){
+        clags_opt_t opt = pending->opt;
+        clags__complete_value(completion, opt.complete, opt.value_type, opt.field_name);
+        return;
+    }
+    if (current[0] == '-'){
+        const char *equals = strchr(current, '=');
+        if (equals == NULL){
+            clags__complete_flags(completion, spec, NULL);
+            if (parent) clags__complete_flags(completion, parent, spec);
+            return;
+        }
+        clags_arg_t *match = clags__complete_lookup(spec, parent, current, equals-current);
+        if (match && match->type == Clags_Optional && match->opt.long_flag && strlen(match->opt.long_flag) == (size_t)(equals-current)){
+            completion->lead = current;
+            completion->lead_length = (size_t)(equals-current) + 1;
+            completion->prefix = equals+1;
+            clags__complete_value(completion, match->opt.complete, match->opt.value_type, match->opt.field_name);
+        }
+        return;
+    }
+    if (required_found >= spec->required_count && !in_list && spec->command_count){
+        for (size_t i=0; i<spec->command_count; ++i){
+            clags_complete_add(completion, spec->commands[i]->cmd.name, spec->commands[i]->cmd.description);
+        }
+        return;
+    }
+    if (required_found < spec->required_count){
+        clags_req_t req = spec->required[required_found]->req;
+        clags__complete_value(completion, req.complete, req.value_type, req.name);
+    }
+}
+
+// the scripts call "program __complete <cword> <words...>", where words[cword] is the word under the cursor
+static const char *clags__complete_scripts[][2] = {
+    {"bash",
+     "_@ID@_complete()\n"
+     "{\n"
+     "    local -a words=(\"${COMP_WORDS[0]}\")\n"
+     "    local i cur=${COMP_WORDS[COMP_CWORD]}\n"
+     "    # bash splits \"--flag=value\" at '=', so the pieces are joined again\n"
+     "    for ((i=1; i<=COMP_CWORD; ++i)); do\n"
+     "        if ((i > 1)) && [[ ${COMP_WORDS[i]} == \"=\" || ${COMP_WORDS[i-1]} == \"=\" ]]; then\n"
+     "            words[${#words[@]}-1]+=${COMP_WORDS[i]}\n"
+     "        else\n"
+     "            words+=(\"${COMP_WORDS[i]}\")\n"
+     "        fi\n"
+     "    done\n"
+     "    [[ $cur == \"=\" ]] && cur=\n"
+     "    local word=${words[${#words[@]}-1]}\n"
+     "    local IFS=$'\\n'\n"
+     "    COMPREPLY=($(\"${COMP_WORDS[0]}\" __complete $((${#words[@]}-1)) \"${words[@]}\" 2>/dev/null))\n"
+     "    COMPREPLY=(\"${COMPREPLY[@]%%$'\\t'*}\")\n"
+     "    COMPREPLY=(\"${COMPREPLY[@]#\"${word:0:${#word}-${#cur}}\"}\")\n"
+     "}\n"
+     "complete -o default -F _@ID@_complete @NAME@\n"},
+    {"zsh",
+     "#compdef @NAME@\n"
+     "_@ID@_complete()\n"
+     "{\n"
+     "    local -a lines candidates descriptions\n"
+     "    local line\n"
+     "    lines=(\"${(@f)$(\"${words[1]}\" __complete $((CURRENT-1)) \"${(@)words[1,CURRENT]}\" 2>/dev/null)}\")\n"
+     "    for line in \"${lines[@]}\"; do\n"
+     "        [[ -z $line ]] && continue\n"
+     "        candidates+=(\"${line%%$'\\t'*}\")\n"
+     "        if [[ $line == *$'\\t'* ]]; then\n"
+     "            descriptions+=(\"${line%%$'\\t'*} -- ${line#*$'\\t'}\")\n"
+     "        else\n"
+     "            descriptions+=(\"$line\")\n"
+     "        fi\n"
+     "    done\n"
+     "    if (( ${#candidates} )); then\n"
+     "        compadd -l -d descriptions -- \"${candidates[@]}\"\n"
+     "    else\n"
+     "        _files\n"
+     "    fi\n"
+     "}\n"
+     "compdef _@ID@_complete @NAME@\n"},
+    {"fish",
+     "function __@ID@_complete\n"
+     "    set -l words (commandline -opc) (commandline -ct)\n"
+     "    $words[1] __complete (math (count $words) - 1) $words 2>/dev/null\n"
+     "end\n"
+     "complete -c @NAME@ -a '(__@ID@_complete)'\n"},
+};
+
+// writes the completion script for a shell, with @NAME@ replaced by the program name and @ID@ by an identifier made from it
+bool clags__complete_script(clags_completion_t *completion, const char *shell, const char *name)
+{
+    const char *script = NULL;
+    for (size_t i=0; i<clags_arr_len(clags__complete_scripts); ++i){
+        if (strcmp(shell, clags__complete_scripts[i][0]) == 0) script = clags__complete_scripts[i][1];
+    }
+    if (script == NULL) return false;
+    const char *slash = strrchr(name, '/');
+    if (slash) name = slash+1;
+    while (*script){
+        if (strncmp(script, "@NAME@", 6) == 0){
+            clags__complete_write(completion, name, strlen(name));
+            script += 6;
+        } else if (strncmp(script, "@ID@", 4) == 0){
+            for (const char *c=name; *c; ++c){
+                char id = (char) ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9')? *c:'_');
+                clags__complete_write(completion, &id, 1);
+            }
+            script += 4;
+        } else{
+            const char *next = strchr(script+1, '@');
+            size_t length = next? (size_t)(next-script):strlen(script);
+            clags__complete_write(completion, script, length);
+            script += length;
+        }
+    }
+    return true;
+}
+
+// answers "program __complete <cword> <words...>" and "program __complete bash|zsh|fish" from the spec;
+// returns false if argv is no completion request, in which case nothing is written
+bool clags_complete_output(int argc, char **argv, clags_spec_t *spec, clags_output_t *output)
+{
+    if (argc < 3 || strcmp(argv[1], "__complete") != 0) return false;
+    clags_completion_t completion_storage = {.output=output, .prefix="", .lead=""};
+    clags_completion_t *completion = &completion_storage;
+    if (!clags__complete_script(completion, argv[2], argv[0])){
+        char *end;
+        long cword = strtol(argv[2], &end, 10);
+        char **words = argv+3;
+        size_t count = (size_t)(argc-3);
+        if (*end == '\0' && cword > 0 && count > 0){
+            // the words behind the cursor do not matter
+            size_t before = (size_t)cword < count? (size_t)cword:count;
+            const char *current = (size_t)cword < count? words[cword]:"";
+            completion->prefix = current;
+            clags__complete_words(completion, spec, NULL, words+1, before-1, current);
+        }
+    }
+    if (completion->length && !clags__output_write(output, completion->buffer, completion->length)) completion->failed = true;
+    if (completion->failed) fprintf(stderr, "[ERROR] Failed to write the completion candidates!\n");
+    return true;
+}
+
+bool clags_complete_spec(int argc, char **argv, clags_spec_t *spec)
+{
+#ifdef CLAGS__POSIX
+    fflush(stdout);
+    clags_output_t output = clags_output_fd(STDOUT_FILENO);
+#else
+    clags_output_t output = clags_output_file(stdout);
+#endif
+    return clags_complete_output(argc, argv, spec, &output);
+}
+
+bool clags__complete(int argc, char **argv, clags_arg_t *args, size_t arg_count)
+{
+    if (argc < 3 || strcmp(argv[1], "__complete") != 0) return false;
+    void *memory[clags__spec_size(args, arg_count)/sizeof(void*) + 1];
+    clags_spec_t spec;
+    clags__spec_init(&spec, args, arg_count, memory);
+    return clags_complete_spec(argc, argv, &spec);
+}
+
+void clags_list_free(clags_list_t *list)
+{
+    clags__free_copies(list);
+    if (list->fixed){
+        list->count = 0;
+        return;
+    }
+    if (list->items) clags__free(&list->allocator, list->items, list->capacity*list->item_size);
+    list->items = NULL;
+    list->count = list->capacity = 0;
+}
+
+#ifdef __cplusplus
+#pragma GCC diagnostic pop
 }
+#endif
 
 #endif // CLAGS_IMPLEMENTATION
@@ -0,0 +1,425 @@
+/*
+  clags.hpp - A typed C++ layer for clags.h
+
+  MIT License, see clags.h
+
+  Requires C++20. The flags are template arguments, so mistakes in the table are compile errors
+  and the flag lookup is a perfect hash built by the compiler. The arguments are plain clags_arg_t,
+  so a clags::spec also works with every C function taking a table.
+*/
+
+#ifndef CLAGS_HPP
+#define CLAGS_HPP
+
+#include "clags.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace clags{
+
+// a string literal as a template argument; "" leaves a flag out
+template<size_t N>
+struct name{
+    char data[N];
+    constexpr name(const char (&str)[N]){ for (size_t i=0; i<N; ++i) data[i] = str[i]; }
+    constexpr size_t length() const { return N-1; }
+    constexpr const char *c_str() const { return N > 1? data:nullptr; }
+};
+
+// a clags_list_t with a known item type, owning its items unless it is backed by a fixed array
+template<typename T>
+struct list{
+    clags_list_t raw;
+
+    list(): raw{nullptr, sizeof(T), 0, 0, {}, false, nullptr} {}
+    template<size_t N>
+    explicit list(T (&array)[N]): raw{array, sizeof(T), 0, N, {}, true, nullptr} {}
+    list(const list&) = delete;
+    list &operator=(const list&) = delete;
+    ~list(){ clags_list_free(&raw); }
+
+    size_t size() const { return raw.count; }
+    T *begin(){ return (T*) raw.items; }
+    T *end(){ return (T*) raw.items + raw.count; }
+    const T *begin() const { return (const T*) raw.items; }
+    const T *end() const { return (const T*) raw.items + raw.count; }
+    T &operator[](size_t i){ return ((T*) raw.items)[i]; }
+    const T &operator[](size_t i) const { return ((const T*) raw.items)[i]; }
+};
+
+namespace detail{
+
+template<typename T> struct target{ using item = T; static constexpr bool is_list = false; };
+template<typename T> struct target<list<T>>{ using item = T; static constexpr bool is_list = true; };
+
+// the built-in conversion for a variable type, Clags_Custom if it needs a value function
+template<typename T>
+constexpr clags_value_type_t value_type()
+{
+    if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) return Clags_None;
+    else if constexpr (std::is_same_v<T, bool>) return Clags_Bool;
+    else if constexpr (std::is_same_v<T, int8_t>) return Clags_Int8;
+    else if constexpr (std::is_same_v<T, uint8_t>) return Clags_UInt8;
+    else if constexpr (std::is_same_v<T, int32_t>) return Clags_Int32;
+    else if constexpr (std::is_same_v<T, uint32_t>) return Clags_UInt32;
+    else if constexpr (std::is_same_v<T, double>) return Clags_Double;
+    else return Clags_Custom;
+}
+
+template<typename T>
+constexpr void check_target()
+{
+    static_assert(!std::is_const_v<T>, "clags: the variable of an argument must not be const");
+    static_assert(!std::is_same_v<T, clags_list_t>, "clags: use clags::list<T> for lists, so the item type is known");
+}
+
+template<typename T>
+constexpr void check_builtin()
+{
+    check_target<T>();
+    static_assert(std::is_const_v<T> || std::is_same_v<T, clags_list_t> || value_type<typename target<T>::item>() != Clags_Custom,
+                  "clags: this variable type has no built-in conversion, pass a clags_value_func_t");
+}
+
+template<typename T>
+void *value(T &variable)
+{
+    if constexpr (target<T>::is_list) return &variable.raw;
+    else return (void*) &variable;
+}
+
+constexpr uint32_t hash(const char *str, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i=0; i<length; ++i){
+        hash ^= (unsigned char) str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+constexpr uint32_t mix(uint32_t hash, uint32_t displacement)
+{
+    hash ^= displacement * 0x9e3779b9u;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+struct key{
+    const char *flag;
+    uint32_t length;
+    uint32_t index;
+};
+
+constexpr bool same_flag(key a, key b)
+{
+    if (a.length != b.length) return false;
+    for (uint32_t i=0; i<a.length; ++i){
+        if (a.flag[i] != b.flag[i]) return false;
+    }
+    return true;
+}
+
+// the flags of all options and flags of a table, in table order
+template<size_t Keys>
+struct key_list{
+    key items[Keys + 1];
+    bool unique;
+};
+
+template<typename... Args>
+constexpr auto collect_keys()
+{
+    constexpr size_t count = ((Args::type == Clags_Required? 0:(Args::lengths[0] != 0) + (Args::lengths[1] != 0)) + ... + 0);
+    key_list<count> keys = {};
+    uint32_t n = 0, index = 0;
+    auto add = [&](clags_arg_type_t type, const char *const (&flags)[2], const uint32_t (&lengths)[2]){
+        for (size_t i=0; i<2 && type != Clags_Required; ++i){
+            if (lengths[i]) keys.items[n++] = key{flags[i], lengths[i], index};
+        }
+        index++;
+    };
+    (add(Args::type, Args::flags, Args::lengths), ...);
+    keys.unique = true;
+    for (size_t i=0; i<count; ++i){
+        for (size_t j=i+1; j<count; ++j) keys.unique &= !same_flag(keys.items[i], keys.items[j]);
+    }
+    return keys;
+}
+
+// a required list takes all remaining positional arguments, so no required argument may follow it
+template<typename... Args>
+constexpr bool list_last()
+{
+    bool list = false, valid = true;
+    ((Args::type == Clags_Required? (valid &= !list, list |= Args::is_list):false), ...);
+    return valid;
+}
+
+// hash and displace: the keys are split into buckets, and every bucket, largest first, gets the displacement
+// that moves all its keys to free slots, so a lookup is one hash, one slot and one comparison
+template<size_t Keys>
+struct perfect_hash{
+    static constexpr size_t bucket_count = Keys/4 + 1;
+    static constexpr size_t slot_count = []{
+        size_t count = 2;
+        while (count < 2*Keys) count *= 2;
+        return count;
+    }();
+
+    uint32_t displacements[bucket_count];
+    key slots[slot_count];
+    bool complete;
+
+    constexpr perfect_hash(const key_list<Keys> &list): displacements{}, slots{}, complete(list.unique)
+    {
+        const key (&keys)[Keys + 1] = list.items;
+        if (!complete) return;
+        uint32_t hashes[Keys + 1] = {};
+        size_t sizes[bucket_count] = {};
+        bool placed[bucket_count] = {};
+        for (size_t i=0; i<Keys; ++i){
+            hashes[i] = hash(keys[i].flag, keys[i].length);
+            sizes[hashes[i] % bucket_count]++;
+        }
+        for (size_t round=0; round<bucket_count; ++round){
+            size_t bucket = 0;
+            while (placed[bucket]) bucket++;
+            for (size_t b=bucket+1; b<bucket_count; ++b){
+                if (!placed[b] && sizes[b] > sizes[bucket]) bucket = b;
+            }
+            placed[bucket] = true;
+            if (sizes[bucket] == 0) continue;
+            uint32_t displacement = 0;
+            while (!fits(hashes, bucket, displacement)){
+                if (++displacement == (1u << 20)){
+                    complete = false;
+                    return;
+                }
+            }
+            displacements[bucket] = displacement;
+            for (size_t i=0; i<Keys; ++i){
+                if (hashes[i] % bucket_count == bucket) slots[mix(hashes[i], displacement) & (slot_count-1)] = keys[i];
+            }
+        }
+    }
+
+    constexpr bool fits(const uint32_t (&hashes)[Keys + 1], size_t bucket, uint32_t displacement) const
+    {
+        for (size_t i=0; i<Keys; ++i){
+            if (hashes[i] % bucket_count != bucket) continue;
+            size_t slot = mix(hashes[i], displacement) & (slot_count-1);
+            if (slots[slot].length) return false;
+            for (size_t j=0; j<i; ++j){
+                if (hashes[j] % bucket_count == bucket && (mix(hashes[j], displacement) & (slot_count-1)) == slot) return false;
+            }
+        }
+        return true;
+    }
+
+    const key *find(const char *flag, size_t length) const
+    {
+        uint32_t h = hash(flag, length);
+        const key *slot = &slots[mix(h, displacements[h % bucket_count]) & (slot_count-1)];
+        if (slot->length == 0 || slot->length != length || std::memcmp(slot->flag, flag, length) != 0) return nullptr;
+        return slot;
+    }
+};
+
+} // namespace detail
+
+// one entry of a spec, holding the clags_arg_t and, as template arguments, what is checked at compile time
+template<clags_arg_type_t Type, name First, name Second, bool List>
+struct argument{
+    static constexpr clags_arg_type_t type = Type;
+    static constexpr bool is_list = List;
+    static constexpr const char *flags[2] = {First.c_str(), Second.c_str()};
+    static constexpr uint32_t lengths[2] = {First.length(), Second.length()};
+
+    clags_arg_t raw;
+
+    argument complete(clags_complete_func_t func) const requires (Type != Clags_Flag)
+    {
+        argument copy = *this;
+        if constexpr (Type == Clags_Required) copy.raw.req.complete = func;
+        else copy.raw.opt.complete = func;
+        return copy;
+    }
+
+    argument on_change(clags_change_func_t func) const
+    {
+        argument copy = *this;
+        if constexpr (Type == Clags_Required) copy.raw.req.on_change = func;
+        else if constexpr (Type == Clags_Optional) copy.raw.opt.on_change = func;
+        else copy.raw.flag.on_change = func;
+        return copy;
+    }
+
+    argument env(const char *variable) const requires (Type == Clags_Optional)
+    {
+        argument copy = *this;
+        copy.raw.opt.env = variable;
+        return copy;
+    }
+
+    argument config(const char *key) const requires (Type == Clags_Optional)
+    {
+        argument copy = *this;
+        copy.raw.opt.config_key = key;
+        return copy;
+    }
+
+    argument lazy(clags_lazy_t &record) const requires (Type != Clags_Flag && !List)
+    {
+        argument copy = *this;
+        if constexpr (Type == Clags_Required) copy.raw.req.lazy = &record;
+        else copy.raw.opt.lazy = &record;
+        return copy;
+    }
+
+    argument separator(char c) const requires (Type == Clags_Optional && List)
+    {
+        argument copy = *this;
+        copy.raw.opt.separator = c;
+        return copy;
+    }
+};
+
+template<name Name, typename T>
+argument<Clags_Required, Name, "", detail::target<T>::is_list> required(T &value, const char *description, clags_value_func_t func)
+{
+    detail::check_target<T>();
+    using item = typename detail::target<T>::item;
+    clags_arg_t raw{};
+    raw.type = Clags_Required;
+    raw.req = clags_req_t{};
+    raw.req.name = Name.c_str();
+    raw.req.value_type = func? Clags_Custom:detail::value_type<item>();
+    raw.req.value = detail::value(value);
+    raw.req.value_func = func;
+    raw.req.description = description;
+    raw.req.is_list = detail::target<T>::is_list;
+    raw.req.value_size = detail::target<T>::is_list? 0:sizeof(T);
+    return {raw};
+}
+
+template<name Name, typename T>
+argument<Clags_Required, Name, "", detail::target<T>::is_list> required(T &value, const char *description)
+{
+    detail::check_builtin<T>();
+    return required<Name>(value, description, (clags_value_func_t) nullptr);
+}
+
+template<name Name, typename T>
+void required(T &value, const char *description, std::nullptr_t) = delete;
+
+template<name Short, name Long, typename T>
+argument<Clags_Optional, Short, Long, detail::target<T>::is_list> option(T &value, const char *field_name, const char *description, clags_value_func_t func)
+{
+    static_assert(Short.length() || Long.length(), "clags: an option needs a short or a long flag");
+    detail::check_target<T>();
+    using item = typename detail::target<T>::item;
+    clags_arg_t raw{};
+    raw.type = Clags_Optional;
+    raw.opt = clags_opt_t{};
+    raw.opt.short_flag = Short.c_str();
+    raw.opt.long_flag = Long.c_str();
+    raw.opt.value_type = func? Clags_Custom:detail::value_type<item>();
+    raw.opt.value = detail::value(value);
+    raw.opt.value_func = func;
+    raw.opt.field_name = field_name;
+    raw.opt.description = description;
+    raw.opt.is_list = detail::target<T>::is_list;
+    raw.opt.value_size = detail::target<T>::is_list? 0:sizeof(T);
+    return {raw};
+}
+
+template<name Short, name Long, typename T>
+argument<Clags_Optional, Short, Long, detail::target<T>::is_list> option(T &value, const char *field_name, const char *description)
+{
+    detail::check_builtin<T>();
+    return option<Short, Long>(value, field_name, description, (clags_value_func_t) nullptr);
+}
+
+template<name Short, name Long, typename T>
+void option(T &value, const char *field_name, const char *description, std::nullptr_t) = delete;
+
+template<name Short, name Long>
+argument<Clags_Flag, Short, Long, false> flag(bool &value, const char *description, bool exit = false)
+{
+    static_assert(Short.length() || Long.length(), "clags: a flag needs a short or a long flag");
+    clags_arg_t raw{};
+    raw.type = Clags_Flag;
+    raw.flag = clags_flag_t{};
+    raw.flag.short_flag = Short.c_str();
+    raw.flag.long_flag = Long.c_str();
+    raw.flag.value = &value;
+    raw.flag.description = description;
+    raw.flag.exit = exit;
+    return {raw};
+}
+
+inline auto help(bool &value)
+{
+    return flag<"-h", "--help">(value, "print this help dialog", true);
+}
+
+// a compiled table; it cannot be copied or moved, as the compiled views point into it
+template<typename... Args>
+class spec{
+public:
+    static constexpr size_t arg_count = sizeof...(Args);
+
+    explicit spec(const Args&... args): args_{args.raw...}
+    {
+        static_assert(keys.unique, "clags: two arguments use the same flag");
+        static_assert(table.complete || !keys.unique, "clags: no perfect hash found for the flags");
+        static_assert(detail::list_last<Args...>(), "clags: only the last required argument may be a list");
+        compiled_ = clags__compile_lookup(&spec_, args_, arg_count, &lookup, nullptr);
+    }
+    spec(const spec&) = delete;
+    spec &operator=(const spec&) = delete;
+    ~spec(){ if (compiled_) clags_spec_free(&spec_); }
+
+    bool parse(int argc, char **argv, const clags_settings_t *settings = nullptr)
+    {
+        return compiled_ && clags_parse_with(argc, argv, &spec_, settings);
+    }
+    bool parse_line(char *line, const clags_settings_t *settings = nullptr)
+    {
+        return compiled_ && clags_parse_line(&spec_, line, settings);
+    }
+    void usage(const char *program_name){ if (compiled_) clags_usage_spec(program_name, &spec_); }
+    bool usage(const char *program_name, clags_output_t *output){ return compiled_ && clags_usage_output(program_name, &spec_, output); }
+    bool complete(int argc, char **argv){ return compiled_ && clags_complete_spec(argc, argv, &spec_); }
+
+    // for the C functions, e.g. clags__parse(argc, argv, spec.args(), spec.size())
+    clags_spec_t *get(){ return compiled_? &spec_:nullptr; }
+    clags_arg_t *args(){ return args_; }
+    size_t size() const { return arg_count; }
+
+private:
+    static constexpr auto keys = detail::collect_keys<Args...>();
+    static constexpr detail::perfect_hash<sizeof(keys.items)/sizeof(keys.items[0]) - 1> table{keys};
+
+    static clags_arg_t *lookup(const clags_spec_t *spec, const char *flag, size_t length)
+    {
+        const detail::key *key = table.find(flag, length);
+        return key? &spec->args[key->index]:nullptr;
+    }
+
+    clags_arg_t args_[arg_count + 1];
+    clags_spec_t spec_{};
+    bool compiled_;
+};
+
+} // namespace clags
+
+#endif // CLAGS_HPP
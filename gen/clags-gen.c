@@ -0,0 +1,432 @@
+// Emits a parser specialized to one argument table.
+// The table is compiled in from a spec header, which defines it at file scope:
+//   cc -DCLAGS_GEN_SPEC='"cli.args.h"' -DCLAGS_GEN_ARGS=cli_args -DCLAGS_GEN_NAME=cli -o clags-gen gen/clags-gen.c
+//   ./clags-gen > cli.parser.h
+// The output defines cli_parse and cli_parse_with and is included after the clags implementation.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include CLAGS_GEN_SPEC
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+#define GEN_STR_(x) #x
+#define GEN_STR(x) GEN_STR_(x)
+
+#define X(type, func, name) [type] = #func,
+static const char *gen_verify_funcs[] = {
+    clags__types
+};
+#undef X
+
+typedef struct{
+    const char *flag;
+    size_t length;
+    size_t index;
+} gen_entry_t;
+
+static const char *table = GEN_STR(CLAGS_GEN_ARGS);
+static const char *name = GEN_STR(CLAGS_GEN_NAME);
+
+static void gen_indent(int depth)
+{
+    for (int i=0; i<depth; ++i) printf("    ");
+}
+
+static void gen_string(const char *str, size_t length)
+{
+    putchar('"');
+    for (size_t i=0; i<length; ++i){
+        unsigned char c = (unsigned char) str[i];
+        if (c == '"' || c == '\\' || c == '?') printf("\\%c", c);
+        else if (c < 32 || c > 126) printf("\\%03o", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+static void gen_char(unsigned char c)
+{
+    if (c == '\'' || c == '\\') printf("'\\%c'", c);
+    else if (c < 32 || c > 126) printf("%d", c);
+    else printf("'%c'", c);
+}
+
+// prints arg advanced by pos characters
+static void gen_arg(size_t pos)
+{
+    if (pos) printf("arg+%zu", pos);
+    else printf("arg");
+}
+
+static int gen_compare(const void *a, const void *b)
+{
+    const gen_entry_t *x = (const gen_entry_t*) a, *y = (const gen_entry_t*) b;
+    if (x->length != y->length) return x->length < y->length? -1:1;
+    return memcmp(x->flag, y->flag, x->length);
+}
+
+// emits a switch per differing character for flags of equal length, sorted and starting to differ at or after pos
+static void gen_trie(gen_entry_t *entries, size_t count, size_t pos, int depth)
+{
+    size_t length = entries[0].length;
+    if (count == 1){
+        gen_indent(depth);
+        if (pos == length){
+            printf("return %zu;\n", entries[0].index);
+        } else{
+            printf("return memcmp(");
+            gen_arg(pos);
+            printf(", ");
+            gen_string(entries[0].flag+pos, length-pos);
+            printf(", %zu) == 0? %zu:-1;\n", length-pos, entries[0].index);
+        }
+        return;
+    }
+    size_t split = pos;
+    while (entries[0].flag[split] == entries[count-1].flag[split]) split++;
+    if (split > pos){
+        gen_indent(depth);
+        printf("if (memcmp(");
+        gen_arg(pos);
+        printf(", ");
+        gen_string(entries[0].flag+pos, split-pos);
+        printf(", %zu) != 0) return -1;\n", split-pos);
+    }
+    gen_indent(depth);
+    printf("switch (arg[%zu]){\n", split);
+    for (size_t i=0; i<count;){
+        size_t j = i+1;
+        while (j < count && entries[j].flag[split] == entries[i].flag[split]) j++;
+        gen_indent(depth+1);
+        printf("case ");
+        gen_char((unsigned char) entries[i].flag[split]);
+        printf(":\n");
+        gen_trie(entries+i, j-i, split+1, depth+2);
+        i = j;
+    }
+    gen_indent(depth);
+    printf("}\n");
+    gen_indent(depth);
+    printf("return -1;\n");
+}
+
+// prints a member of the table entry at index, e.g. "cli_args[3].opt.value", kind being "opt" or "req"
+static void gen_member(size_t index, const char *kind, const char *member)
+{
+    printf("%s[%zu].%s.%s", table, index, kind, member);
+}
+
+// prints the name an argument is reported with, the flag it was given with for options
+static void gen_name(size_t index, const char *kind)
+{
+    if (strcmp(kind, "req") == 0) gen_member(index, kind, "name");
+    else printf("arg_name");
+}
+
+// prints where a value is converted to, the variable of the entry or the list slot
+static void gen_dest(size_t index, const char *kind, bool slot)
+{
+    if (slot) printf("slot");
+    else gen_member(index, kind, "value");
+}
+
+// emits the conversion of value for the entry at index, returning the result of the verify function
+static void gen_convert(clags_value_type_t type, size_t index, const char *kind, bool slot, int depth)
+{
+    gen_indent(depth);
+    if (type == Clags_None){
+        printf("if (");
+        gen_dest(index, kind, slot);
+        printf(") *(char**)(");
+        gen_dest(index, kind, slot);
+        printf(") = value;\n");
+        gen_indent(depth);
+        printf("return true;\n");
+        return;
+    }
+    printf("return %s(", gen_verify_funcs[type]);
+    gen_name(index, kind);
+    printf(", value, ");
+    gen_dest(index, kind, slot);
+    printf(", ");
+    if (type == Clags_Custom) gen_member(index, kind, "value_func");
+    else printf("NULL");
+    printf(", state->error);\n");
+}
+
+int main(void)
+{
+    clags_arg_t *args = CLAGS_GEN_ARGS;
+    size_t arg_count = clags_arr_len(CLAGS_GEN_ARGS);
+    clags_spec_t spec;
+    if (!clags__compile(&spec, args, arg_count, NULL)) return 1;
+    if (spec.command_count){
+        fprintf(stderr, "[ERROR] Tables with commands cannot be generated, generate a parser per command instead!\n");
+        return 1;
+    }
+
+    size_t entry_count = 0;
+    gen_entry_t *entries = calloc(spec.index_mask+1, sizeof(*entries));
+    for (size_t i=0; i<=spec.index_mask; ++i){
+        clags__index_entry_t entry = spec.index[i];
+        if (entry.flag) entries[entry_count++] = (gen_entry_t){.flag=entry.flag, .length=entry.length, .index=(size_t)(entry.arg-args)};
+    }
+    qsort(entries, entry_count, sizeof(*entries), gen_compare);
+
+    printf("// Generated by clags-gen from %s, do not edit.\n", CLAGS_GEN_SPEC);
+    printf("// Parses like clags_parse_with with %s, except that statistics and tracing are not collected.\n\n", table);
+    printf("#ifndef CLAGS_IMPLEMENTATION\n#error \"include the generated parser after the clags implementation\"\n#endif\n\n");
+
+    // without any flags, every token is positional
+    if (entry_count){
+        printf("// returns the table index of the argument using the first length characters of arg as a flag, or -1\n");
+        printf("static int %s__match(const char *arg, size_t length)\n{\n", name);
+        printf("    switch (length){\n");
+        for (size_t i=0; i<entry_count;){
+            size_t j = i+1;
+            while (j < entry_count && entries[j].length == entries[i].length) j++;
+            printf("        case %zu:{\n", entries[i].length);
+            gen_trie(entries+i, j-i, 0, 3);
+            printf("        }\n");
+            i = j;
+        }
+        printf("    }\n    (void) arg;\n    return -1;\n}\n\n");
+    }
+
+    printf("static int %s__short(unsigned char c)\n{\n    switch (c){\n", name);
+    for (size_t c=0; c<256; ++c){
+        if (spec.short_flags[c] == NULL) continue;
+        printf("        case ");
+        gen_char((unsigned char) c);
+        printf(": return %zu;\n", (size_t)(spec.short_flags[c]-args));
+    }
+    printf("    }\n    return -1;\n}\n\n");
+
+    printf("static void %s__set_flag(clags__state_t *state, int index)\n{\n    switch (index){\n", name);
+    for (size_t i=0; i<spec.flag_count; ++i){
+        size_t index = (size_t)(spec.flags[i]-args);
+        printf("        case %zu:\n", index);
+        printf("            if (%s[%zu].flag.value) *%s[%zu].flag.value = true;\n", table, index, table, index);
+        if (spec.flags[i]->flag.exit) printf("            state->exit = true;\n");
+        printf("            break;\n");
+    }
+    printf("    }\n    (void) state;\n}\n\n");
+
+    printf("static bool %s__set_option(clags__state_t *state, int index, const char *arg_name, char *value)\n{\n    switch (index){\n", name);
+    for (size_t i=0; i<spec.optional_count; ++i){
+        size_t index = (size_t)(spec.optional[i]-args);
+        clags_opt_t opt = spec.optional[i]->opt;
+        printf("        case %zu:\n", index);
+        if (opt.is_list) printf("            return clags__append_delimited(state, %s[%zu].opt, arg_name, value);\n", table, index);
+        else if (opt.lazy) printf("            return clags__defer(state, %s[%zu].opt.lazy, arg_name, value);\n", table, index);
+        else gen_convert(opt.value_type, index, "opt", false, 3);
+    }
+    printf("    }\n    (void) state; (void) arg_name; (void) value;\n    return false;\n}\n\n");
+
+    printf("static clags_arg_t *const %s__required[] = {", name);
+    for (size_t i=0; i<spec.required_count; ++i) printf("%s&%s[%zu]", i? ", ":"", table, (size_t)(spec.required[i]-args));
+    printf("%sNULL};\n\n", spec.required_count? ", ":"");
+
+    // positional arguments
+    printf("static bool %s__set_required(clags__state_t *state, char *value)\n{\n    switch (state->required_found){\n", name);
+    for (size_t i=0; i<spec.required_count; ++i){
+        size_t index = (size_t)(spec.required[i]-args);
+        clags_req_t req = spec.required[i]->req;
+        printf("        case %zu:{\n", i);
+        if (req.is_stream){
+            printf("            state->in_list = true;\n");
+            printf("            return clags__stream_item(state, %s[%zu].req, value);\n", table, index);
+        } else if (req.is_list){
+            printf("            state->in_list = true;\n");
+            printf("            clags_list_t *list = (clags_list_t*) %s[%zu].req.value;\n", table, index);
+            printf("            if (!clags__list_reserve(state, list, %s[%zu].req.name, 1)) return false;\n", table, index);
+            printf("            char *slot = (char*) list->items + list->item_size*list->count++;\n");
+            gen_convert(req.value_type, index, "req", true, 3);
+        } else{
+            printf("            state->required_found++;\n");
+            if (req.lazy) printf("            return clags__defer(state, %s[%zu].req.lazy, %s[%zu].req.name, value);\n", table, index, table, index);
+            else gen_convert(req.value_type, index, "req", false, 3);
+        }
+        printf("        }\n");
+    }
+    printf("    }\n    (void) value;\n    return false;\n}\n\n");
+
+    printf("static bool %s__feed(clags__state_t *state, char *arg)\n{\n", name);
+    printf("    if (state->pending){\n");
+    printf("        int index = (int)(state->pending - %s);\n", table);
+    if (spec.fallbacks) printf("        state->seen[index] = true;\n");
+    printf("        state->pending = NULL;\n");
+    printf("        return %s__set_option(state, index, state->pending_flag, arg);\n", name);
+    printf("    }\n");
+    printf("    if (arg[0] == '-' && arg[1] == '-' && arg[2] == '\\0'){\n");
+    printf("        clags__end_list(state);\n");
+    printf("        return true;\n");
+    printf("    }\n\n");
+    printf("    size_t length = strlen(arg);\n");
+    if (entry_count){
+        printf("    int index = %s__match(arg, length);\n", name);
+        printf("    switch (index){\n");
+        for (size_t i=0; i<spec.optional_count; ++i) printf("        case %zu:\n", (size_t)(spec.optional[i]-args));
+        if (spec.optional_count){
+            printf("            clags__end_list(state);\n");
+            printf("            state->pending = &%s[index];\n", table);
+            printf("            state->pending_flag = arg;\n");
+            printf("            return true;\n");
+        }
+        for (size_t i=0; i<spec.flag_count; ++i) printf("        case %zu:\n", (size_t)(spec.flags[i]-args));
+        if (spec.flag_count){
+            printf("            clags__end_list(state);\n");
+            printf("            %s__set_flag(state, index);\n", name);
+            printf("            return true;\n");
+        }
+        printf("    }\n\n");
+    }
+
+    // the designated form only applies to options found through a flag as long as their long flag
+    bool designated = false;
+    for (size_t i=0; i<entry_count; ++i){
+        clags_arg_t *arg = &args[entries[i].index];
+        if (arg->type == Clags_Optional && arg->opt.long_flag && strlen(arg->opt.long_flag) == entries[i].length) designated = true;
+    }
+    if (designated){
+        printf("    char *value = memchr(arg, '=', length);\n");
+        printf("    if (value){\n");
+        printf("        index = %s__match(arg, (size_t)(value-arg));\n", name);
+        printf("        const char *long_flag = NULL;\n");
+        printf("        switch (index){\n");
+        for (size_t i=0; i<spec.optional_count; ++i){
+            size_t index = (size_t)(spec.optional[i]-args);
+            const char *long_flag = args[index].opt.long_flag;
+            if (long_flag == NULL) continue;
+            // reachable through the long flag itself or an equally long short flag
+            size_t long_length = strlen(long_flag);
+            bool reachable = false;
+            for (size_t e=0; e<entry_count; ++e){
+                if (entries[e].index == index && entries[e].length == long_length) reachable = true;
+            }
+            if (!reachable) continue;
+            printf("            case %zu: if ((size_t)(value-arg) == %zu) long_flag = %s[%zu].opt.long_flag; break;\n", index, long_length, table, index);
+        }
+        printf("        }\n");
+        printf("        if (long_flag){\n");
+        if (spec.fallbacks) printf("            state->seen[index] = true;\n");
+        printf("            clags__end_list(state);\n");
+        printf("            if (*++value == '\\0'){\n");
+        printf("                clags__report(state->error, Clags_Error_MissingValue, \"Designated option assignment may not have an empty value: '%%s'!\", arg);\n");
+        printf("                return false;\n");
+        printf("            }\n");
+        printf("            return %s__set_option(state, index, long_flag, value);\n", name);
+        printf("        }\n");
+        printf("    }\n\n");
+    }
+
+    bool streams = false;
+    for (size_t i=0; i<spec.required_count; ++i) streams |= spec.required[i]->req.is_stream;
+    if (streams){
+        printf("    if (arg[0] == '-' && arg[1] == '\\0'){\n");
+        printf("        switch (state->required_found){\n");
+        for (size_t i=0; i<spec.required_count; ++i){
+            if (!spec.required[i]->req.is_stream) continue;
+            printf("            case %zu:\n", i);
+            printf("                state->in_list = true;\n");
+            printf("                return clags__stream_stdin(state, %s[%zu].req);\n", table, (size_t)(spec.required[i]-args));
+        }
+        printf("        }\n");
+        printf("    }\n\n");
+    }
+
+    printf("    if (arg[0] == '-' && arg[1] != '-' && length > 2){\n");
+    printf("        for (size_t c=1; c<length; ++c){\n");
+    printf("            int flag = %s__short((unsigned char) arg[c]);\n", name);
+    printf("            if (flag < 0){\n");
+    printf("                clags__report(state->error, Clags_Error_UnknownFlag, \"Unknown short flag in combination: '-%%c'\", arg[c]);\n");
+    printf("                return false;\n");
+    printf("            }\n");
+    printf("            %s__set_flag(state, flag);\n", name);
+    printf("            if (state->exit) return true;\n");
+    printf("        }\n");
+    printf("        clags__end_list(state);\n");
+    printf("        return true;\n");
+    printf("    }\n\n");
+    printf("    if (*arg == '-'){\n");
+    printf("        clags__report(state->error, Clags_Error_UnknownOption, \"Unknown option: '%%s'!\", arg);\n");
+    printf("        return false;\n");
+    printf("    }\n");
+    printf("    if (state->required_found >= %zu){\n", spec.required_count);
+    printf("        clags__report(state->error, Clags_Error_TooManyArguments, \"Unknown additional argument (%%zu/%%zu): '%%s'!\", state->required_found+1, (size_t)%zu, arg);\n", spec.required_count);
+    printf("        return false;\n");
+    printf("    }\n");
+    printf("    return %s__set_required(state, arg);\n", name);
+    printf("}\n\n");
+
+    // the env index is laid out exactly as in the compiled spec
+    if (spec.env_index){
+        printf("static const clags__index_entry_t %s__env_index[%zu] = {\n", name, spec.env_mask+1);
+        for (size_t i=0; i<=spec.env_mask; ++i){
+            clags__index_entry_t entry = spec.env_index[i];
+            if (entry.flag == NULL) continue;
+            printf("    [%zu] = {", i);
+            gen_string(entry.flag, entry.length);
+            printf(", %uu, %u, &%s[%zu]},\n", entry.hash, entry.length, table, (size_t)(entry.arg-args));
+        }
+        printf("};\n\n");
+    }
+
+    printf("bool %s_parse_with(int argc, char **argv, const clags_settings_t *settings)\n{\n", name);
+    printf("    clags__state_t state = {.response_files=true, .env=true, .feed=%s__feed};\n", name);
+    printf("    if (settings){\n");
+    printf("        state.allocator = settings->allocator;\n");
+    printf("        state.files = settings->files;\n");
+    printf("        state.response_files = !settings->no_response_files;\n");
+    printf("        state.config = settings->config;\n");
+    printf("        state.env = !settings->no_env;\n");
+    printf("        state.error = settings->error;\n");
+    printf("        state.threads = settings->threads;\n");
+    printf("    }\n");
+    if (spec.fallbacks){
+        printf("    bool seen[%zu] = {0};\n", arg_count);
+        printf("    state.seen = seen;\n");
+    }
+    printf("    if (state.error) *state.error = (clags_error_t){0};\n");
+    if (spec.lazy) printf("    clags__lazy_reset(%s, %zu);\n", table, arg_count);
+    printf("    bool result = true;\n");
+    printf("    int index = 1;\n");
+    printf("    for (; index<argc && !state.exit && result; ++index){\n");
+    printf("        char *arg = argv[index];\n");
+    printf("        if (state.response_files && !state.pending && arg[0] == '@' && arg[1] != '\\0') result = clags__expand_response_file(&state, arg+1, 1);\n");
+    printf("        else result = %s__feed(&state, arg);\n", name);
+    printf("    }\n");
+    printf("    if (!result){\n");
+    printf("        if (state.error) state.error->index = (size_t)index-1;\n");
+    printf("        return false;\n");
+    printf("    }\n");
+    printf("    if (state.error) state.error->index = (size_t)argc;\n");
+    printf("    if (state.exit) return true;\n");
+    printf("    if (state.pending){\n");
+    printf("        clags__report(state.error, Clags_Error_MissingValue, \"Optional flag %%s requires argument!\", state.pending_flag);\n");
+    printf("        return false;\n");
+    printf("    }\n");
+    printf("    clags__end_list(&state);\n");
+    printf("    if (state.required_found != %zu){\n", spec.required_count);
+    printf("        clags__report_missing(state.error, %s__required, state.required_found, %zu);\n", name, spec.required_count);
+    printf("        return false;\n");
+    printf("    }\n");
+    if (spec.fallbacks){
+        if (spec.env_index) printf("    return clags__fallback(&state, %s, %zu, %s__env_index, %zu);\n", table, arg_count, name, spec.env_mask);
+        else printf("    return clags__fallback(&state, %s, %zu, NULL, 0);\n", table, arg_count);
+    } else{
+        printf("    return true;\n");
+    }
+    printf("}\n\n");
+
+    printf("bool %s_parse(int argc, char **argv)\n{\n", name);
+    printf("    return %s_parse_with(argc, argv, NULL);\n", name);
+    printf("}\n");
+
+    free(entries);
+    clags_spec_free(&spec);
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Checks how commands are selected: after the required arguments, with the global options still available,
+// shadowed by the flags of the command, and with a command table too large for the buffer on the stack.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+#define TEST_BIG_FLAGS 300  // enough that the table of the big command is taken from the allocator
+
+static char *repo = NULL;
+static bool verbose = false;
+static bool fast = false;
+static char *output = NULL;
+static bool add = false;
+static clags_list_t files = {.item_size=sizeof(char*)};
+static bool force = false;
+static char *mode = NULL;
+static bool rm = false;
+static char *path = NULL;
+static bool recursive = false;
+static bool big = false;
+static bool big_flags[TEST_BIG_FLAGS];
+static char big_names[TEST_BIG_FLAGS][16];
+
+// designated initializers, as some compilers reject the clags_* compound literals at file scope
+static clags_arg_t add_args[] = {
+    {.type=Clags_Required, .req={.name="files", .value=&files, .description="files to add", .is_list=true}},
+    {.type=Clags_Flag, .flag={.short_flag="-f", .long_flag="--force", .value=&force, .description="add ignored files"}},
+    {.type=Clags_Optional, .opt={.short_flag="-m", .long_flag="--mode", .value=&mode, .field_name="MODE", .description="file mode"}},
+};
+static clags_arg_t rm_args[] = {
+    {.type=Clags_Required, .req={.name="path", .value=&path, .description="path to remove"}},
+    {.type=Clags_Flag, .flag={.short_flag="-r", .long_flag="--recursive", .value=&recursive, .description="remove directories"}},
+};
+static clags_arg_t big_args[TEST_BIG_FLAGS];
+static clags_arg_t args[] = {
+    {.type=Clags_Required, .req={.name="repo", .value=&repo, .description="repository"}},
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--verbose", .value=&verbose, .description="verbose output"}},
+    {.type=Clags_Flag, .flag={.short_flag="-f", .long_flag="--fast", .value=&fast, .description="skip checks"}},
+    {.type=Clags_Optional, .opt={.short_flag="-o", .long_flag="--output", .value=&output, .field_name="FILE", .description="log file"}},
+    {.type=Clags_Command, .cmd={.name="add", .value=&add, .args=add_args, .arg_count=clags_arr_len(add_args), .description="add files"}},
+    {.type=Clags_Command, .cmd={.name="rm", .value=&rm, .args=rm_args, .arg_count=clags_arr_len(rm_args), .description="remove files"}},
+    {.type=Clags_Command, .cmd={.name="big", .value=&big, .args=big_args, .arg_count=TEST_BIG_FLAGS, .description="many flags"}},
+};
+
+typedef struct{
+    const char *line;
+    clags_error_code_t code;
+    size_t index;
+    const char *state;  // see render, only compared when the parse succeeds
+} test_case_t;
+
+static const test_case_t cases[] = {
+    {"repo -v add a b -f", Clags_Error_None, 0, "1 0 -|1 0 0|add|a,b,|1 -|0 -|"},
+    {"repo -f add a --mode 644 -v", Clags_Error_None, 0, "1 1 -|1 0 0|add|a,|0 644|0 -|"},
+    {"repo -o log rm --output=log2 -r dir", Clags_Error_None, 0, "0 0 log2|0 1 0|rm||0 -|1 dir|"},
+    {"repo rm -f dir", Clags_Error_None, 0, "0 1 -|0 1 0|rm||0 -|0 dir|"},
+    {"repo big --f299 -v --f7", Clags_Error_None, 0, "1 0 -|0 0 1|big||0 -|0 -|7,299,"},
+    {"repo", Clags_Error_None, 0, "0 0 -|0 0 0|-||0 -|0 -|"},
+    {"repo commit", Clags_Error_UnknownCommand, 2, NULL},
+    {"add a", Clags_Error_UnknownCommand, 2, NULL},
+    {"repo add", Clags_Error_MissingArguments, 3, NULL},
+    {"repo rm dir add", Clags_Error_TooManyArguments, 4, NULL},
+    {"repo rm dir --force", Clags_Error_UnknownOption, 4, NULL},
+};
+
+static void reset(void)
+{
+    repo = output = mode = path = NULL;
+    verbose = fast = add = force = rm = recursive = big = false;
+    memset(big_flags, 0, sizeof(big_flags));
+    clags_list_free(&files);
+}
+
+static void render(char *buf, size_t size, const clags_arg_t *command)
+{
+    size_t n = (size_t) snprintf(buf, size, "%d %d %s|%d %d %d|%s|", verbose, fast, output? output:"-", add, rm, big,
+                                 command? command->cmd.name:"-");
+    for (size_t i=0; i<files.count; ++i) n += (size_t) snprintf(buf+n, size-n, "%s,", ((char**) files.items)[i]);
+    n += (size_t) snprintf(buf+n, size-n, "|%d %s|%d %s|", force, mode? mode:"-", recursive, path? path:"-");
+    for (size_t i=0; i<TEST_BIG_FLAGS; ++i){
+        if (big_flags[i]) n += (size_t) snprintf(buf+n, size-n, "%zu,", i);
+    }
+}
+
+// parses line split at spaces and returns whether the outcome matches the case
+static bool run(clags_spec_t *spec, const test_case_t *test, const clags_settings_t *base)
+{
+    char line[256];
+    char *argv[16] = {"command_test"};
+    int argc = 1;
+    snprintf(line, sizeof(line), "%s", test->line);
+    for (char *token=strtok(line, " "); token; token=strtok(NULL, " ")) argv[argc++] = token;
+
+    clags_error_t error;
+    clags_arg_t *command = NULL;
+    clags_settings_t settings = *base;
+    settings.error = &error;
+    settings.command = &command;
+    settings.no_env = true;
+    reset();
+    bool result = clags_parse_with(argc, argv, spec, &settings);
+    if (result != (test->code == Clags_Error_None) || error.code != test->code || (!result && error.index != test->index)){
+        fprintf(stderr, "[ERROR] '%s': expected error %d at %zu, got error %d at %zu: %s\n", test->line, test->code, test->index,
+                error.code, error.index, error.message);
+        return false;
+    }
+    if (!result) return true;
+    char state[1024];
+    render(state, sizeof(state), command);
+    if (strcmp(state, test->state) == 0) return true;
+    fprintf(stderr, "[ERROR] '%s': expected %s, got %s\n", test->line, test->state, state);
+    return false;
+}
+
+int main(void)
+{
+    for (size_t i=0; i<TEST_BIG_FLAGS; ++i){
+        snprintf(big_names[i], sizeof(big_names[i]), "--f%zu", i);
+        big_args[i] = (clags_arg_t){.type=Clags_Flag, .flag={.long_flag=big_names[i], .value=&big_flags[i], .description="a flag"}};
+    }
+    clags_spec_t spec;
+    if (!clags_compile(&spec, args)) return 1;
+
+    size_t failures = 0;
+    clags_settings_t defaults = {0};
+    // twice over the same spec, so nothing of a selected command may stick to it
+    for (size_t round=0; round<2; ++round){
+        for (size_t i=0; i<clags_arr_len(cases); ++i) failures += !run(&spec, &cases[i], &defaults);
+    }
+
+    // the big command does not fit the stack buffer, so it needs the allocator, while small ones do not
+    char buffer[256];
+    clags_arena_t arena;
+    clags_arena_init(&arena, buffer, sizeof(buffer));
+    clags_allocator_t allocator = clags_arena_allocator(&arena);
+    clags_settings_t small = {.allocator=&allocator};
+    const test_case_t no_memory = {"repo big --f1", Clags_Error_Memory, 2, NULL};
+    failures += !run(&spec, &cases[3], &small);
+    failures += !run(&spec, &no_memory, &small);
+    if (arena.used != 0){
+        fprintf(stderr, "[ERROR] Selecting a small command took %zu bytes from the allocator!\n", arena.used);
+        failures++;
+    }
+
+    reset();
+    clags_spec_free(&spec);
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu checks failed!\n", failures);
+        return 1;
+    }
+    printf("command_test: %zu command lines select and parse their commands\n", clags_arr_len(cases));
+    return 0;
+}
@@ -0,0 +1,128 @@
+// Checks the answers of the completion endpoint: flags, option values after a separate word or after '=',
+// required arguments, command names and the flags of a selected command, and the generated shell scripts.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+static char *input = NULL;
+static char *mode = NULL;
+static bool enabled = false;
+static bool verbose = false;
+static bool add = false;
+static bool force = false;
+static bool quiet = false;
+static bool rm = false;
+
+static void complete_mode(const char *prefix, clags_completion_t *completion)
+{
+    (void) prefix;
+    clags_complete_add(completion, "fast", "quick but rough");
+    clags_complete_add(completion, "slow", NULL);
+}
+
+static void complete_input(const char *prefix, clags_completion_t *completion)
+{
+    (void) prefix;
+    clags_complete_add(completion, "in.txt", NULL);
+    clags_complete_add(completion, "in.csv", NULL);
+}
+
+// designated initializers, as some compilers reject the clags_* compound literals at file scope
+static clags_arg_t add_args[] = {
+    {.type=Clags_Flag, .flag={.short_flag="-f", .long_flag="--force", .value=&force, .description="add ignored files"}},
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--quiet", .value=&quiet, .description="shadows verbose"}},
+};
+static clags_arg_t rm_args[] = {
+    {.type=Clags_Flag, .flag={.short_flag="-f", .long_flag="--force", .value=&force, .description="remove anyway"}},
+};
+static clags_arg_t args[] = {
+    {.type=Clags_Required, .req={.name="input", .value=&input, .description="input file", .complete=complete_input}},
+    {.type=Clags_Optional, .opt={.short_flag="-m", .long_flag="--mode", .value=&mode, .field_name="MODE", .description="the mode", .complete=complete_mode}},
+    {.type=Clags_Optional, .opt={.short_flag="-e", .long_flag="--enabled", .value=&enabled, .value_type=Clags_Bool, .field_name="BOOL", .description="enable"}},
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--verbose", .value=&verbose, .description="verbose output"}},
+    {.type=Clags_Command, .cmd={.name="add", .value=&add, .args=add_args, .arg_count=clags_arr_len(add_args), .description="add files"}},
+    {.type=Clags_Command, .cmd={.name="rm", .value=&rm, .args=rm_args, .arg_count=clags_arr_len(rm_args), .description="remove files"}},
+};
+
+typedef struct{
+    int cword;           // the index of the word under the cursor, words behind the last one are empty
+    const char *words;   // separated by spaces, starting with the program name
+    const char *answer;  // the candidates in the order they are written
+} test_case_t;
+
+static const test_case_t cases[] = {
+    {1, "prog --m", "--mode\tthe mode\n"},
+    {1, "prog --", "--mode\tthe mode\n--enabled\tenable\n--verbose\tverbose output\n"},
+    {2, "prog -m", "fast\tquick but rough\nslow\n"},
+    {2, "prog --mode s", "slow\n"},
+    {1, "prog --mode=f", "--mode=fast\tquick but rough\n"},
+    {1, "prog --enabled=", "--enabled=true\tBOOL\n--enabled=false\tBOOL\n"},
+    {1, "prog -m=f", ""},
+    {1, "prog", "in.txt\nin.csv\n"},
+    {3, "prog -m fast in.c", "in.csv\n"},
+    {2, "prog in.txt", "add\tadd files\nrm\tremove files\n"},
+    {4, "prog -e true in.txt r", "rm\tremove files\n"},
+    {3, "prog in.txt add --", "--force\tadd ignored files\n--quiet\tshadows verbose\n--mode\tthe mode\n--enabled\tenable\n--verbose\tverbose output\n"},
+    {3, "prog in.txt add -", "-f\tadd ignored files\n--force\tadd ignored files\n-v\tshadows verbose\n--quiet\tshadows verbose\n"
+                            "-m\tthe mode\n--mode\tthe mode\n-e\tenable\n--enabled\tenable\n--verbose\tverbose output\n"},
+    {4, "prog in.txt rm --mode", "fast\tquick but rough\nslow\n"},
+    {1, "prog in.txt add", "in.txt\n"},
+};
+
+// answers a completion request into buffer and returns whether it was one
+static bool complete(clags_spec_t *spec, int argc, char **argv, char *buffer, size_t size)
+{
+    clags_output_t output = clags_output_buffer(buffer, size);
+    buffer[0] = '\0';
+    return clags_complete_output(argc, argv, spec, &output);
+}
+
+int main(void)
+{
+    size_t failures = 0;
+    clags_spec_t spec;
+    if (!clags_compile(&spec, args)) return 1;
+
+    static char answer[8192];
+    for (size_t i=0; i<clags_arr_len(cases); ++i){
+        char words[256], cword[16];
+        char *argv[16] = {"completion_test", "__complete", cword};
+        int argc = 3;
+        snprintf(cword, sizeof(cword), "%d", cases[i].cword);
+        snprintf(words, sizeof(words), "%s", cases[i].words);
+        for (char *word=strtok(words, " "); word; word=strtok(NULL, " ")) argv[argc++] = word;
+        if (!complete(&spec, argc, argv, answer, sizeof(answer)) || strcmp(answer, cases[i].answer) != 0){
+            fprintf(stderr, "[ERROR] %d in '%s': expected\n%sbut got\n%s", cases[i].cword, cases[i].words, cases[i].answer, answer);
+            failures++;
+        }
+    }
+
+    char *not_completion[] = {"completion_test", "in.txt", "add"};
+    if (complete(&spec, clags_arr_len(not_completion), not_completion, answer, sizeof(answer)) || answer[0] != '\0'){
+        fprintf(stderr, "[ERROR] A plain command line was answered as a completion request!\n");
+        failures++;
+    }
+
+    // the scripts name the program without its directory, and as an identifier where one is needed
+    const char *shells[][2] = {{"bash", "_my_tool_complete"}, {"zsh", "my-tool"}, {"fish", "my-tool"}};
+    for (size_t i=0; i<clags_arr_len(shells); ++i){
+        char *argv[] = {"./bin/my-tool", "__complete", (char*) shells[i][0]};
+        if (!complete(&spec, clags_arr_len(argv), argv, answer, sizeof(answer)) || strstr(answer, shells[i][1]) == NULL ||
+            strstr(answer, "__complete") == NULL || strstr(answer, "@NAME@") != NULL || strstr(answer, "@ID@") != NULL || strstr(answer, "./bin") != NULL){
+            fprintf(stderr, "[ERROR] The %s script is not for my-tool:\n%s", shells[i][0], answer);
+            failures++;
+        }
+    }
+
+    clags_spec_free(&spec);
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu checks failed!\n", failures);
+        return 1;
+    }
+    printf("completion_test: %zu completion requests answered as expected\n", clags_arr_len(cases));
+    return 0;
+}
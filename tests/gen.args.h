@@ -0,0 +1,55 @@
+// Argument table shared by the generated parser test and clags-gen.
+// Written with designated initializers, as some compilers reject the clags_* compound literals at file scope.
+
+#include <string.h>
+#include "../clags.h"
+
+char *gen_input;
+int32_t gen_count;
+clags_lazy_t gen_count_lazy;
+clags_list_t gen_rest = {.item_size=sizeof(int32_t)};
+
+char *gen_output;
+int8_t gen_level;
+uint8_t gen_quality;
+uint32_t gen_size;
+double gen_ratio;
+clags_lazy_t gen_ratio_lazy;
+bool gen_enabled;
+char *gen_mode;
+clags_list_t gen_tags = {.item_size=sizeof(char*)};
+clags_list_t gen_ports = {.item_size=sizeof(uint32_t)};
+
+bool gen_verbose;
+bool gen_quiet;
+bool gen_all;
+bool gen_help;
+bool gen_shadowed;
+
+static bool gen_check_mode(const char *arg_name, const char *arg, void *pvalue)
+{
+    (void) arg_name;
+    if (strcmp(arg, "fast") != 0 && strcmp(arg, "slow") != 0) return false;
+    if (pvalue) *(const char**)pvalue = arg;
+    return true;
+}
+
+clags_arg_t gen_args[] = {
+    {.type=Clags_Required, .req={.name="input", .value=&gen_input, .description="the input"}},
+    {.type=Clags_Optional, .opt={.short_flag="-o", .long_flag="--output", .value=&gen_output, .field_name="FILE", .description="the output", .config_key="output"}},
+    {.type=Clags_Required, .req={.name="count", .value=&gen_count, .value_type=Clags_Int32, .description="a count", .lazy=&gen_count_lazy}},
+    {.type=Clags_Optional, .opt={.short_flag="-l", .long_flag="--level", .value=&gen_level, .value_type=Clags_Int8, .field_name="N", .description="int8", .env="GEN_LEVEL"}},
+    {.type=Clags_Optional, .opt={.long_flag="--quality", .value=&gen_quality, .value_type=Clags_UInt8, .field_name="N", .description="uint8", .env="GEN_QUALITY"}},
+    {.type=Clags_Optional, .opt={.short_flag="-s", .long_flag="--size", .value=&gen_size, .value_type=Clags_UInt32, .field_name="N", .description="uint32", .env="GEN_SIZE", .config_key="size"}},
+    {.type=Clags_Optional, .opt={.short_flag="-r", .value=&gen_ratio, .value_type=Clags_Double, .field_name="X", .description="double", .lazy=&gen_ratio_lazy}},
+    {.type=Clags_Optional, .opt={.short_flag="-e", .long_flag="--enabled", .value=&gen_enabled, .value_type=Clags_Bool, .field_name="B", .description="bool"}},
+    {.type=Clags_Optional, .opt={.short_flag="-m", .long_flag="--mode", .value=&gen_mode, .value_type=Clags_Custom, .value_func=gen_check_mode, .field_name="M", .description="custom", .config_key="mode"}},
+    {.type=Clags_Optional, .opt={.short_flag="-t", .long_flag="--tags", .value=&gen_tags, .field_name="T", .description="tags", .is_list=true, .config_key="tags"}},
+    {.type=Clags_Optional, .opt={.short_flag="-p", .long_flag="--ports", .value=&gen_ports, .value_type=Clags_UInt32, .field_name="P", .description="ports", .is_list=true, .separator=':', .env="GEN_PORTS", .config_key="ports"}},
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--verbose", .value=&gen_verbose, .description="verbose"}},
+    {.type=Clags_Flag, .flag={.short_flag="-q", .long_flag="--quiet", .value=&gen_quiet, .description="quiet"}},
+    {.type=Clags_Flag, .flag={.short_flag="a", .long_flag="--all", .value=&gen_all, .description="no dash"}},
+    {.type=Clags_Flag, .flag={.short_flag="-h", .long_flag="--help", .value=&gen_help, .description="help", .exit=true}},
+    {.type=Clags_Flag, .flag={.short_flag="-o", .long_flag="--size", .value=&gen_shadowed, .description="shadowed by options"}},
+    {.type=Clags_Required, .req={.name="rest", .value=&gen_rest, .value_type=Clags_Int32, .description="the rest", .is_list=true}},
+};
@@ -0,0 +1,145 @@
+// Checks that the parser generated by clags-gen from gen.args.h behaves exactly like clags_parse_with,
+// by running both on random command lines and comparing the results, errors and all targets.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+#include "gen.args.h"
+#include "gen.parser.h"
+
+#define TEST_CASES 200000
+#define TEST_MAX_TOKENS 8
+
+#define TEST_CONFIG \
+    "# fallbacks for options missing from the command line and the environment\n" \
+    "output = from-config\n" \
+    "size=11\n" \
+    "  mode = \"slow\"  \n" \
+    "tags = c1,c2\n" \
+    "ports = 7:8"
+
+// every environment variable takes one of these values per case, NULL unsets it
+static const char *env_names[] = {"GEN_LEVEL", "GEN_QUALITY", "GEN_SIZE", "GEN_PORTS"};
+static const char *env_values[][3] = {
+    {NULL, "4", "-129"},
+    {NULL, "200", "999"},
+    {NULL, "", "13"},
+    {NULL, "5:6", "5::6"},
+};
+
+static const char *tokens[] = {
+    "-o", "--output", "-l", "--level", "--quality", "-s", "--size", "-r", "-e", "--enabled",
+    "-m", "--mode", "-t", "--tags", "-p", "--ports", "-v", "--verbose", "-q", "--quiet",
+    "a", "--all", "-h", "--help", "--", "-", "-vq", "-vqa", "-vx", "-ov", "-o=3", "--bogus", "-z",
+    "--output=x", "--output=", "--level=5", "--size=12", "--tags=a,b", "--tags=a,,b", "--ports=1:2",
+    "--ports=1:x", "--mode=fast", "--mode=bad", "--all=1", "--quality=256", "=",
+    "file", "12", "-5", "300", "4294967295", "4294967296", "1.5", "1e400", "true", "no",
+    "fast", "slow", "x,y", "a,b,c", "1:2:3", ":1", "0x10", "", "007", "2147483648",
+    "@tests/gen_test.rsp", "@tests/gen_nested.rsp", "@tests/gen_missing.rsp",
+};
+
+static void reset(void)
+{
+    gen_input = gen_output = gen_mode = NULL;
+    gen_count = 0;
+    gen_level = 0;
+    gen_quality = 0;
+    gen_size = 0;
+    gen_ratio = 0;
+    gen_enabled = gen_verbose = gen_quiet = gen_all = gen_help = gen_shadowed = false;
+    clags_list_free(&gen_rest);
+    clags_list_free(&gen_tags);
+    clags_list_free(&gen_ports);
+}
+
+// renders the outcome of a parse, so two parses can be compared as strings
+static void snapshot(char *buf, size_t size, bool result, clags_error_t *error)
+{
+    size_t n = (size_t) snprintf(buf, size, "%d %d %zu %s|%s %d %s %d %u %u %g %d %s|%d%d%d%d%d|",
+        result, error->code, error->index, error->message, gen_input? gen_input:"-", gen_count, gen_output? gen_output:"-",
+        gen_level, gen_quality, gen_size, gen_ratio, gen_enabled, gen_mode? gen_mode:"-",
+        gen_verbose, gen_quiet, gen_all, gen_help, gen_shadowed);
+    // a failed conversion leaves its list slot undefined
+    n += (size_t) snprintf(buf+n, size-n, "%zu %zu %zu|", gen_rest.count, gen_tags.count, gen_ports.count);
+    // lazy arguments keep their token until they are accessed
+    n += (size_t) snprintf(buf+n, size-n, "%d %s %d %s|", gen_count_lazy.pending, gen_count_lazy.token? gen_count_lazy.token:"-",
+                           gen_ratio_lazy.pending, gen_ratio_lazy.token? gen_ratio_lazy.token:"-");
+    if (!result) return;
+    for (size_t i=0; i<gen_rest.count && n<size; ++i) n += (size_t) snprintf(buf+n, size-n, "%d,", ((int32_t*)gen_rest.items)[i]);
+    for (size_t i=0; i<gen_tags.count && n<size; ++i) n += (size_t) snprintf(buf+n, size-n, "%s;", ((char**)gen_tags.items)[i]);
+    for (size_t i=0; i<gen_ports.count && n<size; ++i) n += (size_t) snprintf(buf+n, size-n, "%u:", ((uint32_t*)gen_ports.items)[i]);
+}
+
+static bool write_file(const char *path, const char *content)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) return false;
+    fputs(content, f);
+    return fclose(f) == 0;
+}
+
+int main(void)
+{
+    if (!write_file("tests/gen_test.rsp", "-v 'quoted value' 42 --tags=\"x,y\"\n-l 3") ||
+        !write_file("tests/gen_nested.rsp", "@tests/gen_test.rsp -s 7") ||
+        !write_file("tests/gen_test.conf", TEST_CONFIG)){
+        fprintf(stderr, "[ERROR] Could not write the response and config files!\n");
+        return 1;
+    }
+    clags_config_t config;
+    if (!clags_config_load(&config, "tests/gen_test.conf", NULL)) return 1;
+    clags_spec_t spec;
+    if (!clags_compile(&spec, gen_args)) return 1;
+
+    srand(1);
+    size_t failures = 0, successes = 0;
+    for (size_t c=0; c<TEST_CASES; ++c){
+        int argc = 1 + rand()%(TEST_MAX_TOKENS+1);
+        size_t picks[TEST_MAX_TOKENS+1];
+        for (int i=1; i<argc; ++i) picks[i] = (size_t) rand() % clags_arr_len(tokens);
+        for (size_t i=0; i<clags_arr_len(env_names); ++i){
+            const char *value = env_values[i][rand()%3];
+            if (value) setenv(env_names[i], value, 1);
+            else unsetenv(env_names[i]);
+        }
+        bool use_config = rand()%4 != 0;
+
+        char expected[4096], actual[4096];
+        // both passes share the tokens, so a parse that changes them shows up as a difference
+        char *argv[TEST_MAX_TOKENS+1] = {"gen_test"};
+        for (int i=1; i<argc; ++i) argv[i] = strdup(tokens[picks[i]]);
+        for (int pass=0; pass<2; ++pass){
+            clags_files_t files = {0};
+            clags_error_t error;
+            clags_settings_t settings = {.files=&files, .error=&error, .config=use_config? &config:NULL};
+            reset();
+            bool result = pass == 0? clags_parse_with(argc, argv, &spec, &settings):gen_parse_with(argc, argv, &settings);
+            snapshot(pass == 0? expected:actual, sizeof(expected), result, &error);
+            successes += pass == 0 && result;
+            clags_files_free(&files);
+        }
+        for (int i=1; i<argc; ++i) free(argv[i]);
+        if (strcmp(expected, actual) != 0){
+            if (failures++ < 10){
+                fprintf(stderr, "[ERROR] Case %zu differs:", c);
+                for (int i=1; i<argc; ++i) fprintf(stderr, " '%s'", tokens[picks[i]]);
+                fprintf(stderr, "\n  clags_parse_with: %s\n  gen_parse_with:   %s\n", expected, actual);
+            }
+        }
+    }
+    reset();
+    clags_spec_free(&spec);
+    clags_config_free(&config);
+    remove("tests/gen_test.conf");
+    remove("tests/gen_test.rsp");
+    remove("tests/gen_nested.rsp");
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu of %d cases differ!\n", failures, TEST_CASES);
+        return 1;
+    }
+    printf("gen_test: %d cases identical, %zu of them valid\n", TEST_CASES, successes);
+    return 0;
+}
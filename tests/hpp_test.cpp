@@ -0,0 +1,150 @@
+// Checks that a clags::spec parses like the C parser on the same table: the flags found through the perfect hash,
+// the deduced value types, lists with a separator, custom values, errors and the usage.
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+struct point_t{
+    int32_t x, y;
+};
+
+static bool parse_point(const char *arg_name, const char *arg, void *pvalue)
+{
+    point_t *point = (point_t*) pvalue;
+    char end;
+    (void) arg_name;
+    return sscanf(arg, "%d:%d%c", &point->x, &point->y, &end) == 2;
+}
+
+static const char *input = nullptr;
+static uint32_t threads = 4;
+static double ratio = 0.5;
+static int8_t level = 0;
+static point_t origin{0, 0};
+static clags::list<int32_t> ids;
+static clags::list<const char*> files;
+static bool verbose = false, force = false, help = false;
+
+struct test_case_t{
+    const char *line;
+    clags_error_code_t code;
+    const char *state;  // see render, only compared when the parse succeeds
+};
+
+static const test_case_t cases[] = {
+    {"in a b", Clags_Error_None, "in 4 0.5 0 0:0 | a,b, 0 0 0"},
+    {"-t 8 --ratio 0.25 in a -v", Clags_Error_None, "in 8 0.25 0 0:0 | a, 1 0 0"},
+    {"in --threads=16 -l -3 -vf a", Clags_Error_None, "in 16 0.5 -3 0:0 | a, 1 1 0"},
+    {"--origin 3:-4 -i 1:2:3 in x --ids=4", Clags_Error_None, "in 4 0.5 0 3:-4 1,2,3,4,| x, 0 0 0"},
+    {"in a -- -v --force", Clags_Error_None, "in 4 0.5 0 0:0 | a, 1 1 0"},
+    {"-h", Clags_Error_None, "- 4 0.5 0 0:0 | 0 0 1"},
+    {"in", Clags_Error_MissingArguments, nullptr},
+    {"in a --thread 2", Clags_Error_UnknownOption, nullptr},
+    {"in a --threadss 2", Clags_Error_UnknownOption, nullptr},
+    {"in a -x", Clags_Error_UnknownOption, nullptr},
+    {"in a --verbose=1", Clags_Error_UnknownOption, nullptr},
+    {"in a -t -1", Clags_Error_OutOfRange, nullptr},
+    {"in a -l 200", Clags_Error_OutOfRange, nullptr},
+    {"in a --origin 3", Clags_Error_Rejected, nullptr},
+    {"in a -i 1::2", Clags_Error_InvalidValue, nullptr},
+    {"in a --ratio", Clags_Error_MissingValue, nullptr},
+};
+
+static void reset()
+{
+    input = nullptr;
+    threads = 4;
+    ratio = 0.5;
+    level = 0;
+    origin = {0, 0};
+    clags_list_free(&ids.raw);
+    clags_list_free(&files.raw);
+    verbose = force = help = false;
+}
+
+static void render(char *buf, size_t size)
+{
+    size_t n = (size_t) snprintf(buf, size, "%s %u %g %d %d:%d ", input? input:"-", threads, ratio, level, origin.x, origin.y);
+    for (int32_t id: ids) n += (size_t) snprintf(buf+n, size-n, "%d,", id);
+    n += (size_t) snprintf(buf+n, size-n, "| ");
+    for (const char *file: files) n += (size_t) snprintf(buf+n, size-n, "%s,", file);
+    snprintf(buf+n, size-n, "%s%d %d %d", files.size()? " ":"", verbose, force, help);
+}
+
+// parses line split at spaces, and returns the error code and the rendered state
+template<typename Parse>
+static clags_error_code_t run(const char *line, char *state, size_t size, Parse parse)
+{
+    char copy[256];
+    char *argv[16] = {(char*) "hpp_test"};
+    int argc = 1;
+    snprintf(copy, sizeof(copy), "%s", line);
+    for (char *token=strtok(copy, " "); token; token=strtok(nullptr, " ")) argv[argc++] = token;
+    clags_error_t error;
+    clags_settings_t settings{};
+    settings.error = &error;
+    settings.no_env = true;
+    reset();
+    bool result = parse(argc, argv, &settings);
+    render(state, size);
+    return result? Clags_Error_None:error.code;
+}
+
+int main()
+{
+    clags::spec spec(
+        clags::required<"input">(input, "the input file"),
+        clags::required<"files">(files, "files to process"),
+        clags::option<"-t", "--threads">(threads, "N", "worker threads"),
+        clags::option<"", "--ratio">(ratio, "R", "ratio"),
+        clags::option<"-l", "">(level, "L", "level"),
+        clags::option<"", "--origin">(origin, "X:Y", "origin", parse_point),
+        clags::option<"-i", "--ids">(ids, "ID", "ids").separator(':'),
+        clags::flag<"-v", "--verbose">(verbose, "verbose output"),
+        clags::flag<"-f", "--force">(force, "force"),
+        clags::help(help));
+    // the same table through the C parser, which builds its own flag index
+    clags_spec_t c_spec;
+    if (spec.get() == nullptr || !clags__compile(&c_spec, spec.args(), spec.size(), nullptr)) return 1;
+
+    size_t failures = 0;
+    for (const test_case_t &test: cases){
+        char state[256], c_state[256];
+        clags_error_code_t code = run(test.line, state, sizeof(state), [&](int argc, char **argv, const clags_settings_t *settings){
+            return spec.parse(argc, argv, settings);
+        });
+        clags_error_code_t c_code = run(test.line, c_state, sizeof(c_state), [&](int argc, char **argv, const clags_settings_t *settings){
+            return clags_parse_with(argc, argv, &c_spec, settings);
+        });
+        if (code != test.code || c_code != code || (code == Clags_Error_None && (strcmp(state, test.state) != 0 || strcmp(c_state, state) != 0))){
+            fprintf(stderr, "[ERROR] '%s': expected error %d and %s\n", test.line, test.code, test.state? test.state:"-");
+            fprintf(stderr, "  but got error %d and %s, and error %d and %s from C\n", code, state, c_code, c_state);
+            failures++;
+        }
+    }
+
+    static char usage[4096], c_usage[4096];
+    clags_output_t output{}, c_output{};
+    output.kind = c_output.kind = Clags_Output_Buffer;
+    output.buffer = usage;
+    output.capacity = sizeof(usage);
+    c_output.buffer = c_usage;
+    c_output.capacity = sizeof(c_usage);
+    if (!spec.usage("hpp_test", &output) || !clags_usage_output("hpp_test", &c_spec, &c_output) ||
+        strcmp(usage, c_usage) != 0 || strstr(usage, "--origin") == nullptr){
+        fprintf(stderr, "[ERROR] The usage differs from the C usage of the same table:\n%s\n%s", usage, c_usage);
+        failures++;
+    }
+    clags_spec_free(&c_spec);
+
+    reset();
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu checks failed!\n", failures);
+        return 1;
+    }
+    printf("hpp_test: %zu command lines parse like the C parser\n", sizeof(cases)/sizeof(cases[0]));
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Checks how clags_parse_line splits a command line: whitespace, single and double quotes, backslash escapes,
+// empty and joined tokens, literal '@' tokens, and the token indexes of errors.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+static clags_list_t words = {.item_size=sizeof(char*)};
+static char *output = NULL;
+static clags_list_t tags = {.item_size=sizeof(char*)};
+static bool verbose = false;
+
+// designated initializers, as some compilers reject the clags_* compound literals at file scope
+static clags_arg_t args[] = {
+    {.type=Clags_Required, .req={.name="words", .value=&words, .description="any words", .is_list=true}},
+    {.type=Clags_Optional, .opt={.short_flag="-o", .long_flag="--output", .value=&output, .field_name="FILE", .description="output file"}},
+    {.type=Clags_Optional, .opt={.long_flag="--tags", .value=&tags, .field_name="TAG,..", .description="tags", .is_list=true}},
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--verbose", .value=&verbose, .description="verbose output"}},
+};
+
+typedef struct{
+    const char *line;
+    clags_error_code_t code;
+    size_t index;
+    const char *state;  // the words between brackets, then output, tags and verbose; only compared on success
+} test_case_t;
+
+static const test_case_t cases[] = {
+    {"a b  c", Clags_Error_None, 0, "[a][b][c] - 0"},
+    {" \ta\nb\r\n c\v\f", Clags_Error_None, 0, "[a][b][c] - 0"},
+    {"'hello world' \"x  y\"", Clags_Error_None, 0, "[hello world][x  y] - 0"},
+    {"a\\ b \\'c\\' \\\\", Clags_Error_None, 0, "[a b]['c'][\\] - 0"},
+    {"\"say \\\"hi\\\"\" 'it''s' pre\"fix\"'ed'", Clags_Error_None, 0, "[say \"hi\"][its][prefixed] - 0"},
+    {"\"back\\\\slash\" \"a\\b\" 'lit\\n' 'no\\'", Clags_Error_None, 0, "[back\\slash][a\\b][lit\\n][no\\] - 0"},
+    {"x \"\" '' y", Clags_Error_None, 0, "[x][][][y] - 0"},
+    {"-v -o 'out file' x --tags=\"a,b c\"", Clags_Error_None, 0, "[x] out file a;b c; 1"},
+    {"@file '@quoted'", Clags_Error_None, 0, "[@file][@quoted] - 0"},
+    {"a -- -v", Clags_Error_None, 0, "[a] - 1"},
+    {"a \"b", Clags_Error_Input, 1, NULL},
+    {"a 'b c", Clags_Error_Input, 1, NULL},
+    {"", Clags_Error_MissingArguments, 0, NULL},
+    {"   ", Clags_Error_MissingArguments, 0, NULL},
+    {"a b -z c", Clags_Error_UnknownOption, 2, NULL},
+    {"'-v' '--tags=a,,b'", Clags_Error_InvalidValue, 1, NULL},
+    {"a -o", Clags_Error_MissingValue, 2, NULL},
+};
+
+static void reset(void)
+{
+    clags_list_free(&words);
+    clags_list_free(&tags);
+    output = NULL;
+    verbose = false;
+}
+
+static void render(char *buf, size_t size)
+{
+    size_t n = 0;
+    buf[0] = '\0';
+    for (size_t i=0; i<words.count; ++i) n += (size_t) snprintf(buf+n, size-n, "[%s]", ((char**) words.items)[i]);
+    n += (size_t) snprintf(buf+n, size-n, " %s ", output? output:"-");
+    for (size_t i=0; i<tags.count; ++i) n += (size_t) snprintf(buf+n, size-n, "%s;", ((char**) tags.items)[i]);
+    snprintf(buf+n, size-n, "%s%d", tags.count? " ":"", verbose);
+}
+
+int main(void)
+{
+    size_t failures = 0;
+    clags_spec_t spec;
+    if (!clags_compile(&spec, args)) return 1;
+
+    for (size_t i=0; i<clags_arr_len(cases); ++i){
+        char line[256], state[512];
+        snprintf(line, sizeof(line), "%s", cases[i].line);
+        clags_error_t error;
+        clags_settings_t settings = {.error=&error, .no_env=true};
+        reset();
+        bool result = clags_parse_line(&spec, line, &settings);
+        if (result) render(state, sizeof(state));
+        if (result != (cases[i].code == Clags_Error_None) || error.code != cases[i].code || (!result && error.index != cases[i].index) ||
+            (result && strcmp(state, cases[i].state) != 0)){
+            fprintf(stderr, "[ERROR] '%s': expected error %d at %zu and %s\n", cases[i].line, cases[i].code, cases[i].index, cases[i].state? cases[i].state:"-");
+            fprintf(stderr, "  but got error %d at %zu (%s) and %s\n", error.code, error.index, error.message, result? state:"-");
+            failures++;
+        }
+    }
+
+    reset();
+    clags_spec_free(&spec);
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu checks failed!\n", failures);
+        return 1;
+    }
+    printf("line_test: %zu command lines split and parsed as expected\n", clags_arr_len(cases));
+    return 0;
+}
@@ -0,0 +1,255 @@
+// Checks that parsing time grows linearly with the input, using command lines shaped to hit the worst case of
+// every part of the parser: huge flag clusters, long near-miss flags, many separators and giant lists.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// built once with the defaults and once with a CLAGS_PARALLEL_THRESHOLD above every input, where list runs
+// are only scanned, which has to happen once per run and not once per token; below the threshold a run
+// costs at most CLAGS_PARALLEL_THRESHOLD scans and grows linearly either way
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+#define TEST_UNITS (1 << 15)  // tokens or bytes of the smaller input
+#define TEST_SCALE 8          // the larger input is this many times the smaller one
+#define TEST_MAX_RATIO 24     // linear growth takes about TEST_SCALE times as long, quadratic growth TEST_SCALE^2
+#define TEST_REPEATS 5        // the fastest of these runs counts
+
+static clags_list_t numbers = {.item_size=sizeof(int32_t)};
+static clags_list_t tags = {.item_size=sizeof(char*)};
+static char *output = NULL;
+static int32_t level = 0;
+static bool verbose = false;
+static bool quiet = false;
+
+// designated initializers, as some compilers reject the clags_* compound literals at file scope
+static clags_arg_t args[] = {
+    {.type=Clags_Required, .req={.name="numbers", .value=&numbers, .value_type=Clags_Int32, .description="any number of integers", .is_list=true}},
+    {.type=Clags_Optional, .opt={.short_flag="-o", .long_flag="--output", .value=&output, .field_name="FILE", .description="output file"}},
+    {.type=Clags_Optional, .opt={.short_flag="-l", .long_flag="--level", .value=&level, .value_type=Clags_Int32, .field_name="N", .description="level"}},
+    {.type=Clags_Optional, .opt={.short_flag="-t", .long_flag="--tags", .value=&tags, .field_name="TAG,..", .description="tags", .is_list=true}},
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--verbose", .value=&verbose, .description="verbose output"}},
+    {.type=Clags_Flag, .flag={.short_flag="-q", .long_flag="--quiet", .value=&quiet, .description="quiet output"}},
+};
+
+// a command line of count tokens stored one after another in data, or a single line for clags_parse_line
+typedef struct{
+    char *data;
+    size_t length;
+    char **argv;
+    int argc;
+} test_input_t;
+
+static void add_token(test_input_t *input, const char *token)
+{
+    size_t length = strlen(token);
+    memcpy(input->data + input->length, token, length+1);
+    input->length += length+1;
+    input->argc++;
+}
+
+// appends to the last token instead of starting a new one
+static void extend_token(test_input_t *input, const char *text, size_t times)
+{
+    size_t length = strlen(text);
+    input->length--;
+    for (size_t i=0; i<times; ++i){
+        memcpy(input->data + input->length, text, length);
+        input->length += length;
+    }
+    input->data[input->length++] = '\0';
+}
+
+static void cluster(test_input_t *input, size_t n)           { add_token(input, "-"); extend_token(input, "vq", n/2); }
+static void cluster_unknown(test_input_t *input, size_t n)   { add_token(input, "-"); extend_token(input, "v", n); extend_token(input, "x", 1); }
+static void near_miss_long(test_input_t *input, size_t n)    { add_token(input, "--verbos"); extend_token(input, "e", n); }
+static void near_miss_assign(test_input_t *input, size_t n)  { add_token(input, "--outpu"); extend_token(input, "t", n); extend_token(input, "=x", 1); }
+static void long_value(test_input_t *input, size_t n)        { add_token(input, "--output="); extend_token(input, "x", n); }
+static void long_number(test_input_t *input, size_t n)       { add_token(input, "--level=0"); extend_token(input, "0", n); extend_token(input, "7", 1); }
+static void list_option(test_input_t *input, size_t n)       { add_token(input, "--tags=a"); extend_token(input, ",a", n/2); }
+static void separators(test_input_t *input, size_t n)        { for (size_t i=0; i<n; ++i) add_token(input, "--"); }
+static void list_tokens(test_input_t *input, size_t n)       { for (size_t i=0; i<n; ++i) add_token(input, "12345"); }
+static void option_values(test_input_t *input, size_t n)     { for (size_t i=0; i<n/2; ++i){ add_token(input, "-l"); add_token(input, "5"); } }
+
+#define TEST_EMPTY_FILE "tests/linear_empty.rsp"
+
+// an empty response file ends a run without ending the list
+static void list_runs(test_input_t *input, size_t n)
+{
+    for (size_t i=0; i<n; ++i) add_token(input, i % (n/4) == n/4-1? "@" TEST_EMPTY_FILE:"7");
+}
+
+static void line(test_input_t *input, size_t n)
+{
+    add_token(input, "1 ");
+    input->length--;
+    for (size_t i=0; i<n/8; ++i){
+        memcpy(input->data + input->length, "-o 'a b' ", 9);
+        input->length += 9;
+    }
+    input->data[input->length++] = '\0';
+}
+
+typedef struct{
+    const char *name;
+    void (*build)(test_input_t *input, size_t n);
+    bool valid;
+    bool line;
+} test_shape_t;
+
+static const test_shape_t shapes[] = {
+    {"huge cluster",            cluster,          true,  false},
+    {"unknown flag in cluster", cluster_unknown,  false, false},
+    {"long near-miss flag",     near_miss_long,   false, false},
+    {"long near-miss with '='", near_miss_assign, false, false},
+    {"long option value",       long_value,       true,  false},
+    {"long number",             long_number,      true,  false},
+    {"giant list option",       list_option,      true,  false},
+    {"many separators",         separators,       true,  false},
+    {"giant list",              list_tokens,      true,  false},
+    {"list runs",               list_runs,        true,  false},
+    {"repeated option",         option_values,    true,  false},
+    {"command line",            line,             true,  true},
+};
+
+static double now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec*1e-9;
+}
+
+// the fastest of a few parses of the shape with n units, or a negative time if the result was not the expected one
+static double measure(clags_spec_t *spec, const test_shape_t *shape, size_t n)
+{
+    // no shape takes more than 10 bytes per unit
+    test_input_t input = {.data=malloc(n*10 + 64), .argv=malloc((n+2)*sizeof(char*))};
+    double best = -1;
+    for (int r=0; r<TEST_REPEATS; ++r){
+        input.length = 0;
+        input.argc = 0;
+        // the required list needs one number
+        add_token(&input, "linear_test");
+        if (shape->line) input.length = input.argc = 0;
+        else add_token(&input, "1");
+        shape->build(&input, n);
+        char *token = input.data;
+        for (int i=0; i<input.argc; ++i){
+            input.argv[i] = token;
+            token += strlen(token)+1;
+        }
+
+        clags_files_t files = {0};
+        clags_error_t error;
+        clags_settings_t settings = {.files=&files, .error=&error, .threads=1, .no_env=true};
+        double start = now();
+        bool result = shape->line? clags_parse_line(spec, input.data, &settings):clags_parse_with(input.argc, input.argv, spec, &settings);
+        double time = now() - start;
+        clags_list_free(&numbers);
+        clags_list_free(&tags);
+        clags_files_free(&files);
+        if (result != shape->valid){
+            fprintf(stderr, "[ERROR] %s: unexpected result %d: %s\n", shape->name, result, error.message);
+            best = -1;
+            break;
+        }
+        if (best < 0 || time < best) best = time;
+        // a shape this slow has failed anyway, so it is not repeated
+        if (best > 0.5) break;
+    }
+    free(input.data);
+    free(input.argv);
+    return best;
+}
+
+// writes levels files, each naming the next one fanout times and padded with spaces, the last one holding a number
+static bool write_chain(size_t levels, size_t fanout, size_t padding)
+{
+    for (size_t i=1; i<=levels; ++i){
+        char path[64];
+        snprintf(path, sizeof(path), "tests/linear_chain%zu.rsp", i);
+        FILE *f = fopen(path, "w");
+        if (f == NULL) return false;
+        for (size_t j=0; i<levels && j<fanout; ++j) fprintf(f, "@tests/linear_chain%zu.rsp\n", i+1);
+        if (i == levels) fprintf(f, "1\n");
+        for (size_t j=0; j<padding; ++j) fputc(' ', f);
+        if (fclose(f) != 0) return false;
+    }
+    return true;
+}
+
+// response files naming each other many times would be read exponentially often without the limits,
+// be they many small files or a few large ones
+static bool check_response_limits(clags_spec_t *spec)
+{
+    const struct{
+        size_t fanout;
+        size_t padding;
+        const char *message;
+    } chains[] = {
+        {5, 0, "More than"},
+        {2, (size_t)3 << 19, "Response files exceed"},
+    };
+    bool ok = true;
+    for (size_t i=0; i<clags_arr_len(chains); ++i){
+        if (!write_chain(CLAGS_RESPONSE_FILE_DEPTH, chains[i].fanout, chains[i].padding)){
+            fprintf(stderr, "[ERROR] Could not write the response files!\n");
+            return false;
+        }
+        char *argv[] = {"linear_test", "@tests/linear_chain1.rsp"};
+        clags_files_t files = {0};
+        clags_error_t error;
+        clags_settings_t settings = {.files=&files, .error=&error, .no_env=true};
+        bool result = clags_parse_with(2, argv, spec, &settings);
+        clags_list_free(&numbers);
+        clags_files_free(&files);
+        if (result || error.code != Clags_Error_ResponseFile || strncmp(error.message, chains[i].message, strlen(chains[i].message)) != 0){
+            fprintf(stderr, "[ERROR] Nested response files were not stopped by their limit: %s\n", result? "parsed":error.message);
+            ok = false;
+        }
+    }
+    for (size_t i=1; i<=CLAGS_RESPONSE_FILE_DEPTH; ++i){
+        char path[64];
+        snprintf(path, sizeof(path), "tests/linear_chain%zu.rsp", i);
+        remove(path);
+    }
+    return ok;
+}
+
+int main(void)
+{
+    FILE *empty = fopen(TEST_EMPTY_FILE, "w");
+    if (empty == NULL || fclose(empty) != 0){
+        fprintf(stderr, "[ERROR] Could not write the response file!\n");
+        return 1;
+    }
+    clags_spec_t spec;
+    if (!clags_compile(&spec, args)) return 1;
+    size_t failures = 0;
+    for (size_t i=0; i<clags_arr_len(shapes); ++i){
+        double small = measure(&spec, &shapes[i], TEST_UNITS);
+        double large = measure(&spec, &shapes[i], TEST_UNITS*TEST_SCALE);
+        if (small < 0 || large < 0){
+            failures++;
+            continue;
+        }
+        // inputs parsed in next to no time only tell the clock resolution apart
+        double ratio = large / (small > 1e-6? small:1e-6);
+        if (ratio > TEST_MAX_RATIO){
+            fprintf(stderr, "[ERROR] %s: %.3f ms for %d units, but %.3f ms for %d times as many (x%.1f)!\n",
+                    shapes[i].name, small*1e3, TEST_UNITS, large*1e3, TEST_SCALE, ratio);
+            failures++;
+        }
+    }
+    if (!check_response_limits(&spec)) failures++;
+    clags_spec_free(&spec);
+    remove(TEST_EMPTY_FILE);
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu of %zu checks failed!\n", failures, clags_arr_len(shapes)+1);
+        return 1;
+    }
+    printf("linear_test: %zu input shapes grow linearly with lists chunked from %d items\n", clags_arr_len(shapes), CLAGS_PARALLEL_THRESHOLD);
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Checks that the integer scanner and the fast path for doubles accept, reject and convert exactly like the
+// strtol, strtoul and strtod checks they replaced, on edge cases and on random numbers around them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+#define TEST_CASES 500000
+
+static const char *edge_cases[] = {
+    "", " ", "-", "+", "--1", "+-1", " 1", "\t\n-7", "1 ", "0", "-0", "+0", "00000000", "000000000000000000000",
+    "127", "128", "-128", "-129", "255", "256", "-1", "-255",
+    "2147483647", "2147483648", "-2147483648", "-2147483649", "4294967295", "4294967296", "-4294967295",
+    "00000000004294967295", "99999999999", "18446744073709551615", "18446744073709551616", "12345678", "123456789",
+    "1234567a", "12345678a", "0x10", "1e3", "1.5", ".5", "5.", ".", "e5", "1e", "1e+", "1e-5", "1E22", "1e23", "-1e-22",
+    "9007199254740992", "9007199254740993", "9999999999999999999", "10000000000000000000", "0.1", "0.30000000000000004",
+    "123456789012345678e-22", "1e400", "-1e400", "1e-400", "inf", "-infinity", "nan", "0x1p3", "1,5",
+};
+
+static const char *verify_names[] = {"int8", "uint8", "int32", "uint32"};
+static const clags_value_verify_t verifiers[] = {clags__verify_int8, clags__verify_uint8, clags__verify_int32, clags__verify_uint32};
+
+// the strtol and strtoul checks the integer types used before clags__scan_integer
+static clags_error_code_t expected_integer(size_t type, const char *arg, int64_t *value)
+{
+    char *endptr;
+    errno = 0;
+    bool is_signed = type == 0 || type == 2;
+    long svalue = is_signed? strtol(arg, &endptr, 10):0;
+    unsigned long uvalue = is_signed? 0:strtoul(arg, &endptr, 10);
+    if (*endptr != '\0') return Clags_Error_InvalidValue;
+    bool in_range;
+    switch(type){
+        case 0:  in_range = svalue >= INT8_MIN && svalue <= INT8_MAX; break;
+        case 1:  in_range = uvalue <= UINT8_MAX; break;
+        case 2:  in_range = svalue >= INT32_MIN && svalue <= INT32_MAX; break;
+        default: in_range = uvalue <= UINT32_MAX; break;
+    }
+    if (errno == ERANGE || !in_range) return Clags_Error_OutOfRange;
+    *value = is_signed? (int64_t) svalue:(int64_t) uvalue;
+    return Clags_Error_None;
+}
+
+static int64_t converted_integer(size_t type, const void *slot)
+{
+    switch(type){
+        case 0:  return *(const int8_t*) slot;
+        case 1:  return *(const uint8_t*) slot;
+        case 2:  return *(const int32_t*) slot;
+        default: return *(const uint32_t*) slot;
+    }
+}
+
+// the strtod check doubles used before the fast path
+static clags_error_code_t expected_double(const char *arg, double *value)
+{
+    char *endptr;
+    errno = 0;
+    *value = strtod(arg, &endptr);
+    if (*endptr != '\0') return Clags_Error_InvalidValue;
+    if (errno == ERANGE || *value > DBL_MAX || *value < -DBL_MAX) return Clags_Error_OutOfRange;
+    return Clags_Error_None;
+}
+
+static size_t append_digits(char *buf, size_t n, size_t count)
+{
+    for (size_t i=0; i<count; ++i) buf[n++] = (char) ('0' + rand()%10);
+    return n;
+}
+
+// a number with optional space, sign, leading zeros, fraction and exponent, sometimes with a stray character
+static void random_number(char *buf, bool fraction)
+{
+    static const char *prefixes[] = {"", "", "", "", "", " ", "\t", "-", "-", "+"};
+    static const char stray[] = " x.+-e0";
+    size_t n = (size_t) sprintf(buf, "%s", prefixes[rand()%clags_arr_len(prefixes)]);
+    if (rand()%4 == 0){
+        size_t zeros = (size_t) (rand()%12);
+        memset(buf+n, '0', zeros);
+        n += zeros;
+    }
+    n = append_digits(buf, n, (size_t) (rand()%22));
+    if (fraction && rand()%2){
+        buf[n++] = '.';
+        n = append_digits(buf, n, (size_t) (rand()%20));
+    }
+    if (fraction && rand()%2){
+        buf[n++] = rand()%2? 'e':'E';
+        if (rand()%2) buf[n++] = rand()%2? '-':'+';
+        n = append_digits(buf, n, (size_t) (rand()%3));
+    }
+    if (rand()%16 == 0){
+        size_t at = (size_t) rand() % (n+1);
+        memmove(buf+at+1, buf+at, n-at);
+        buf[at] = stray[rand()%(sizeof(stray)-1)];
+        n++;
+    }
+    buf[n] = '\0';
+}
+
+static size_t failures = 0;
+
+static void check_integer(size_t type, const char *arg)
+{
+    int64_t expected = 0;
+    clags_error_code_t code = expected_integer(type, arg, &expected);
+    clags_error_t error = {Clags_Error_None};
+    uint32_t slot = 0;
+    verifiers[type]("n", arg, &slot, NULL, &error);
+    if (error.code == code && (code != Clags_Error_None || converted_integer(type, &slot) == expected)) return;
+    if (failures++ < 10){
+        fprintf(stderr, "[ERROR] %s '%s': expected error %d and %lld, got error %d and %lld\n", verify_names[type], arg,
+                code, (long long) expected, error.code, (long long) converted_integer(type, &slot));
+    }
+}
+
+static bool check_double(const char *arg)
+{
+    double expected = 0, actual = 0, fast = 0;
+    clags_error_code_t code = expected_double(arg, &expected);
+    clags_error_t error = {Clags_Error_None};
+    clags__verify_double("d", arg, &actual, NULL, &error);
+    bool took_fast_path = clags__fast_double(arg, &fast);
+    // the fast path only answers valid input and has to round exactly like strtod
+    bool same = error.code == code && (code != Clags_Error_None || memcmp(&actual, &expected, sizeof(double)) == 0) &&
+                (!took_fast_path || (code == Clags_Error_None && memcmp(&fast, &expected, sizeof(double)) == 0));
+    if (!same && failures++ < 10){
+        fprintf(stderr, "[ERROR] double '%s': expected error %d and %.17g, got error %d and %.17g%s\n", arg, code, expected,
+                error.code, actual, took_fast_path? " on the fast path":"");
+    }
+    return took_fast_path;
+}
+
+int main(void)
+{
+    for (size_t i=0; i<clags_arr_len(edge_cases); ++i){
+        for (size_t type=0; type<clags_arr_len(verifiers); ++type) check_integer(type, edge_cases[i]);
+        check_double(edge_cases[i]);
+    }
+
+    srand(1);
+    char buf[128];
+    size_t fast = 0;
+    for (size_t c=0; c<TEST_CASES; ++c){
+        random_number(buf, false);
+        check_integer((size_t) rand() % clags_arr_len(verifiers), buf);
+        random_number(buf, true);
+        fast += check_double(buf);
+    }
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu numbers differ!\n", failures);
+        return 1;
+    }
+    printf("number_test: %d integers and %d doubles convert like strtol, strtoul and strtod, %zu on the fast path\n",
+           TEST_CASES, TEST_CASES, fast);
+    return 0;
+}
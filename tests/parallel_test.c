@@ -0,0 +1,116 @@
+// Checks that thread-safe custom lists converted on the pool call their function on the same items and print
+// the same errors as the sequential path, both for a run of required list tokens and for a delimited option value.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+#define TEST_ITEMS 1000
+
+static size_t calls = 0;
+
+// prints its own message like the validators in example.c; items starting with 'y' are invalid
+static bool check_item(const char *arg_name, const char *arg, void *pvalue)
+{
+    __atomic_fetch_add(&calls, 1, __ATOMIC_RELAXED);
+    if (arg[0] == 'y'){
+        fprintf(stderr, "invalid %s '%s'\n", arg_name, arg);
+        return false;
+    }
+    *(const char**)pvalue = arg;
+    return true;
+}
+
+static clags_list_t items = {.item_size=sizeof(char*)};
+
+// designated initializers, as some compilers reject the clags_* compound literals at file scope
+static clags_arg_t sequential_args[] = {
+    {.type=Clags_Required, .req={.name="items", .value=&items, .value_type=Clags_Custom, .value_func=check_item, .description="items", .is_list=true}},
+    {.type=Clags_Optional, .opt={.long_flag="--items", .value=&items, .value_type=Clags_Custom, .value_func=check_item, .field_name="I,..", .description="items", .is_list=true}},
+};
+static clags_arg_t parallel_args[] = {
+    {.type=Clags_Required, .req={.name="items", .value=&items, .value_type=Clags_Custom, .value_func=check_item, .description="items", .is_list=true, .thread_safe=true}},
+    {.type=Clags_Optional, .opt={.long_flag="--items", .value=&items, .value_type=Clags_Custom, .value_func=check_item, .field_name="I,..", .description="items", .is_list=true, .thread_safe=true}},
+};
+
+// the outcome of one parse: everything printed to stderr, the number of calls and the number of items
+typedef struct{
+    char output[4096];
+    size_t calls;
+    size_t count;
+    bool result;
+} test_run_t;
+
+static test_run_t run(clags_arg_t *args, size_t arg_count, int argc, char **argv, size_t threads)
+{
+    test_run_t outcome = {0};
+    FILE *capture = tmpfile();
+    int saved = dup(STDERR_FILENO);
+    fflush(stderr);
+    dup2(fileno(capture), STDERR_FILENO);
+
+    clags_spec_t spec;
+    clags__compile(&spec, args, arg_count, NULL);
+    clags_settings_t settings = {.threads=threads, .no_env=true};
+    calls = 0;
+    outcome.result = clags_parse_with(argc, argv, &spec, &settings);
+    outcome.calls = calls;
+    outcome.count = items.count;
+    clags_list_free(&items);
+    clags_spec_free(&spec);
+
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+    rewind(capture);
+    outcome.output[fread(outcome.output, 1, sizeof(outcome.output)-1, capture)] = '\0';
+    fclose(capture);
+    return outcome;
+}
+
+static bool compare(const char *name, test_run_t expected, test_run_t actual, bool same_calls)
+{
+    if (expected.result == actual.result && expected.count == actual.count && strcmp(expected.output, actual.output) == 0 &&
+        (!same_calls || expected.calls == actual.calls)) return true;
+    fprintf(stderr, "[ERROR] %s: %d, %zu items, %zu calls, printed\n%s", name, expected.result, expected.count, expected.calls, expected.output);
+    fprintf(stderr, "but on the pool %d, %zu items, %zu calls, printed\n%s", actual.result, actual.count, actual.calls, actual.output);
+    return false;
+}
+
+int main(void)
+{
+    static char tokens[TEST_ITEMS][16];
+    static char option[TEST_ITEMS*8 + 16] = "--items=";
+    char *argv[TEST_ITEMS+1] = {"parallel_test"};
+    size_t failures = 0;
+    // no failure, one failure, and a second one far behind the first
+    const size_t invalid[][2] = {{SIZE_MAX, SIZE_MAX}, {4, SIZE_MAX}, {4, 899}, {700, 701}};
+    for (size_t c=0; c<clags_arr_len(invalid); ++c){
+        size_t length = strlen("--items=");
+        for (size_t i=0; i<TEST_ITEMS; ++i){
+            bool bad = i == invalid[c][0] || i == invalid[c][1];
+            snprintf(tokens[i], sizeof(tokens[i]), "%c%zu", bad? 'y':'x', i);
+            argv[i+1] = tokens[i];
+            length += (size_t) sprintf(option+length, "%s%s", i? ",":"", tokens[i]);
+        }
+
+        // runs of required list tokens are converted in chunks even on one thread, with exactly the same calls
+        test_run_t expected = run(sequential_args, 1, TEST_ITEMS+1, argv, 8);
+        if (!compare("list tokens on one thread", expected, run(parallel_args, 1, TEST_ITEMS+1, argv, 1), true)) failures++;
+        if (!compare("list tokens on eight threads", expected, run(parallel_args, 1, TEST_ITEMS+1, argv, 8), false)) failures++;
+
+        char *option_argv[] = {"parallel_test", option};
+        expected = run(sequential_args+1, 1, 2, option_argv, 8);
+        if (!compare("list option on eight threads", expected, run(parallel_args+1, 1, 2, option_argv, 8), false)) failures++;
+    }
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu checks failed!\n", failures);
+        return 1;
+    }
+    printf("parallel_test: thread-safe custom lists print and stop like the sequential path\n");
+    return 0;
+}
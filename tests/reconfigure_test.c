@@ -0,0 +1,178 @@
+// Checks that clags_reconfigure applies only the values that changed, calls on_change with the new and the previous
+// value, resets missing flags, keeps missing options, and changes nothing at all when the new vector is invalid.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+typedef struct{
+    int32_t x, y;
+} point_t;
+
+static char *name = NULL;
+static uint32_t threads = 1;
+static double ratio = 0.5;
+static point_t origin = {0, 0};
+static clags_list_t tags = {.item_size=sizeof(char*)};
+static int32_t id_items[4];
+static clags_list_t ids = {.items=id_items, .item_size=sizeof(int32_t), .capacity=4, .fixed=true};
+static bool verbose = false;
+static char changes[1024];
+
+static bool parse_point(const char *arg_name, const char *arg, void *pvalue)
+{
+    point_t *point = (point_t*) pvalue;
+    char end;
+    if (sscanf(arg, "%d:%d%c", &point->x, &point->y, &end) == 2) return true;
+    fprintf(stderr, "[ERROR] Invalid point for argument '%s': '%s'!\n", arg_name, arg);
+    return false;
+}
+
+static void describe(char *buf, size_t size, const char *arg_name, const void *value)
+{
+    if (strcmp(arg_name, "name") == 0) snprintf(buf, size, "%s", *(char* const*) value);
+    else if (strcmp(arg_name, "--threads") == 0) snprintf(buf, size, "%u", *(const uint32_t*) value);
+    else if (strcmp(arg_name, "--ratio") == 0) snprintf(buf, size, "%g", *(const double*) value);
+    else if (strcmp(arg_name, "--origin") == 0) snprintf(buf, size, "%d:%d", ((const point_t*) value)->x, ((const point_t*) value)->y);
+    else if (strcmp(arg_name, "--verbose") == 0) snprintf(buf, size, "%d", *(const bool*) value);
+    else{
+        const clags_list_t *list = (const clags_list_t*) value;
+        size_t n = 0;
+        buf[0] = '\0';
+        for (size_t i=0; i<list->count && n<size; ++i){
+            if (strcmp(arg_name, "--tags") == 0) n += (size_t) snprintf(buf+n, size-n, "%s,", ((char**) list->items)[i]);
+            else n += (size_t) snprintf(buf+n, size-n, "%d,", ((int32_t*) list->items)[i]);
+        }
+    }
+}
+
+// logs every change; the previous value has to be intact while the callback runs
+static void changed(const char *arg_name, void *value, const void *old_value)
+{
+    char now[128], before[128];
+    describe(now, sizeof(now), arg_name, value);
+    describe(before, sizeof(before), arg_name, old_value);
+    size_t n = strlen(changes);
+    snprintf(changes+n, sizeof(changes)-n, "%s %s->%s;", arg_name, before, now);
+}
+
+// designated initializers, as some compilers reject the clags_* compound literals at file scope
+static clags_arg_t args[] = {
+    {.type=Clags_Required, .req={.name="name", .value=&name, .description="service name", .on_change=changed}},
+    {.type=Clags_Optional, .opt={.short_flag="-t", .long_flag="--threads", .value=&threads, .value_type=Clags_UInt32, .field_name="N", .description="worker threads", .on_change=changed}},
+    {.type=Clags_Optional, .opt={.long_flag="--ratio", .value=&ratio, .value_type=Clags_Double, .field_name="R", .description="ratio", .on_change=changed}},
+    {.type=Clags_Optional, .opt={.long_flag="--origin", .value=&origin, .value_type=Clags_Custom, .value_func=parse_point, .field_name="X:Y", .description="origin", .on_change=changed, .value_size=sizeof(point_t)}},
+    {.type=Clags_Optional, .opt={.long_flag="--tags", .value=&tags, .field_name="TAG,..", .description="tags", .on_change=changed, .is_list=true}},
+    {.type=Clags_Optional, .opt={.long_flag="--ids", .value=&ids, .value_type=Clags_Int32, .field_name="ID,..", .description="ids", .on_change=changed, .is_list=true}},
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--verbose", .value=&verbose, .description="verbose output", .on_change=changed}},
+};
+
+static char *streamed = NULL;
+static bool sub = false;
+static bool all = false;
+static clags_arg_t sub_args[] = {
+    {.type=Clags_Flag, .flag={.long_flag="--all", .value=&all, .description="all"}},
+};
+static clags_arg_t command_args[] = {
+    {.type=Clags_Command, .cmd={.name="sub", .value=&sub, .args=sub_args, .arg_count=clags_arr_len(sub_args), .description="a command"}},
+};
+static clags_arg_t sizeless_args[] = {
+    {.type=Clags_Optional, .opt={.long_flag="--origin", .value=&origin, .value_type=Clags_Custom, .value_func=parse_point, .field_name="X:Y", .description="origin"}},
+};
+static clags_arg_t stream_args[] = {
+    {.type=Clags_Required, .req={.name="lines", .value=&streamed, .description="lines", .is_list=true, .is_stream=true}},
+};
+
+typedef struct{
+    const char *line;
+    clags_error_code_t code;
+    const char *changes;  // the on_change calls in table order
+    const char *state;    // see render, which has to be the same after a failure as before
+} test_step_t;
+
+static const test_step_t steps[] = {
+    {"svc -t 8 --tags a,b", Clags_Error_None, "--threads 4->8;--verbose 1->0;", "svc 8 0.5 0:0 a,b, 1,2, 0"},
+    {"svc -t 16 --tags x --ratio nope", Clags_Error_InvalidValue, "", "svc 8 0.5 0:0 a,b, 1,2, 0"},
+    {"svc -t 16 --ids 1,2,3,4,5", Clags_Error_ListFull, "", "svc 8 0.5 0:0 a,b, 1,2, 0"},
+    {"svc --tags c -v --ids 3 --origin 3:4", Clags_Error_None, "--origin 0:0->3:4;--tags a,b,->c,;--ids 1,2,->3,;--verbose 0->1;", "svc 8 0.5 3:4 c, 3, 1"},
+    {"web --ratio 0.25 -v --tags c", Clags_Error_None, "name svc->web;--ratio 0.5->0.25;", "web 8 0.25 3:4 c, 3, 1"},
+    {"web -v", Clags_Error_None, "", "web 8 0.25 3:4 c, 3, 1"},
+};
+
+static void render(char *buf, size_t size)
+{
+    char tag_list[128], id_list[128];
+    describe(tag_list, sizeof(tag_list), "--tags", &tags);
+    describe(id_list, sizeof(id_list), "--ids", &ids);
+    snprintf(buf, size, "%s %u %g %d:%d %s %s %d", name? name:"-", threads, ratio, origin.x, origin.y, tag_list, id_list, verbose);
+}
+
+// splits line at spaces into argv, whose tokens stay valid as long as the values point into them
+static int split(char *line, char **argv, size_t capacity)
+{
+    int argc = 1;
+    argv[0] = "reconfigure_test";
+    for (char *token=strtok(line, " "); token && (size_t)argc < capacity; token=strtok(NULL, " ")) argv[argc++] = token;
+    return argc;
+}
+
+static bool rejects(clags_arg_t *table, size_t count, const char *what)
+{
+    clags_spec_t spec;
+    clags__compile(&spec, table, count, NULL);
+    char *argv[] = {"reconfigure_test"};
+    clags_error_t error;
+    clags_settings_t settings = {.error=&error, .no_env=true};
+    bool result = clags_reconfigure(1, argv, &spec, &settings);
+    clags_spec_free(&spec);
+    if (!result && error.code == Clags_Error_Input) return true;
+    fprintf(stderr, "[ERROR] A table with %s was reconfigured!\n", what);
+    return false;
+}
+
+int main(void)
+{
+    size_t failures = 0;
+    clags_spec_t spec;
+    if (!clags_compile(&spec, args)) return 1;
+
+    static char lines[clags_arr_len(steps)+1][128];
+    char *argv[16];
+    snprintf(lines[0], sizeof(lines[0]), "svc -t 4 --tags a,b -v --ids 1,2");
+    clags_settings_t settings = {.no_env=true};
+    if (!clags_parse_with(split(lines[0], argv, 16), argv, &spec, &settings)) return 1;
+
+    for (size_t i=0; i<clags_arr_len(steps); ++i){
+        snprintf(lines[i+1], sizeof(lines[i+1]), "%s", steps[i].line);
+        int argc = split(lines[i+1], argv, 16);
+        clags_error_t error;
+        settings.error = &error;
+        changes[0] = '\0';
+        bool result = clags_reconfigure(argc, argv, &spec, &settings);
+        char state[256];
+        render(state, sizeof(state));
+        if (result != (steps[i].code == Clags_Error_None) || error.code != steps[i].code ||
+            strcmp(changes, steps[i].changes) != 0 || strcmp(state, steps[i].state) != 0){
+            fprintf(stderr, "[ERROR] '%s': expected error %d, changes '%s' and %s\n", steps[i].line, steps[i].code, steps[i].changes, steps[i].state);
+            fprintf(stderr, "  but got error %d, changes '%s' and %s\n", error.code, changes, state);
+            failures++;
+        }
+    }
+
+    failures += !rejects(command_args, clags_arr_len(command_args), "commands");
+    failures += !rejects(sizeless_args, clags_arr_len(sizeless_args), "a custom value without a size");
+    failures += !rejects(stream_args, clags_arr_len(stream_args), "a stream");
+
+    clags_spec_free(&spec);
+    clags_list_free(&tags);
+    clags_list_free(&ids);
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu checks failed!\n", failures);
+        return 1;
+    }
+    printf("reconfigure_test: %zu reconfigurations change exactly what they should\n", clags_arr_len(steps));
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Checks that a snapshot restores every target, including the table of the selected command, and that a snapshot
+// is rejected by a table whose command tables differ.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+static bool verbose = false;
+static char *name = NULL;
+static clags_list_t sizes = {.item_size=sizeof(int32_t)};
+static bool build = false;
+static char *target = NULL;
+static int32_t jobs = 0;
+static clags_list_t defines = {.item_size=sizeof(char*)};
+static bool release = false;
+static bool clean = false;
+static bool all = false;
+
+// designated initializers, as some compilers reject the clags_* compound literals at file scope
+static clags_arg_t build_args[] = {
+    {.type=Clags_Required, .req={.name="target", .value=&target, .description="target to build"}},
+    {.type=Clags_Optional, .opt={.short_flag="-j", .long_flag="--jobs", .value=&jobs, .value_type=Clags_Int32, .field_name="N", .description="parallel jobs"}},
+    {.type=Clags_Optional, .opt={.short_flag="-D", .long_flag="--defines", .value=&defines, .field_name="NAME,..", .description="defines", .is_list=true}},
+    {.type=Clags_Flag, .flag={.long_flag="--release", .value=&release, .description="optimized build"}},
+};
+static clags_arg_t clean_args[] = {
+    {.type=Clags_Flag, .flag={.long_flag="--all", .value=&all, .description="remove everything"}},
+};
+static clags_arg_t args[] = {
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--verbose", .value=&verbose, .description="verbose output"}},
+    {.type=Clags_Optional, .opt={.short_flag="-n", .long_flag="--name", .value=&name, .field_name="NAME", .description="project name"}},
+    {.type=Clags_Optional, .opt={.short_flag="-s", .long_flag="--sizes", .value=&sizes, .value_type=Clags_Int32, .field_name="N,..", .description="sizes", .is_list=true}},
+    {.type=Clags_Command, .cmd={.name="build", .value=&build, .args=build_args, .arg_count=clags_arr_len(build_args), .description="build a target"}},
+    {.type=Clags_Command, .cmd={.name="clean", .value=&clean, .args=clean_args, .arg_count=clags_arr_len(clean_args), .description="remove outputs"}},
+};
+
+// the same table, but the build command takes its jobs unsigned
+static uint32_t wide_jobs = 0;
+static clags_arg_t wide_build_args[] = {
+    {.type=Clags_Required, .req={.name="target", .value=&target, .description="target to build"}},
+    {.type=Clags_Optional, .opt={.short_flag="-j", .long_flag="--jobs", .value=&wide_jobs, .value_type=Clags_UInt32, .field_name="N", .description="parallel jobs"}},
+    {.type=Clags_Optional, .opt={.short_flag="-D", .long_flag="--defines", .value=&defines, .field_name="NAME,..", .description="defines", .is_list=true}},
+    {.type=Clags_Flag, .flag={.long_flag="--release", .value=&release, .description="optimized build"}},
+};
+static clags_arg_t wide_args[] = {
+    {.type=Clags_Flag, .flag={.short_flag="-v", .long_flag="--verbose", .value=&verbose, .description="verbose output"}},
+    {.type=Clags_Optional, .opt={.short_flag="-n", .long_flag="--name", .value=&name, .field_name="NAME", .description="project name"}},
+    {.type=Clags_Optional, .opt={.short_flag="-s", .long_flag="--sizes", .value=&sizes, .value_type=Clags_Int32, .field_name="N,..", .description="sizes", .is_list=true}},
+    {.type=Clags_Command, .cmd={.name="build", .value=&build, .args=wide_build_args, .arg_count=clags_arr_len(wide_build_args), .description="build a target"}},
+    {.type=Clags_Command, .cmd={.name="clean", .value=&clean, .args=clean_args, .arg_count=clags_arr_len(clean_args), .description="remove outputs"}},
+};
+
+static void reset(void)
+{
+    verbose = false;
+    name = NULL;
+    sizes.count = 0;
+    build = false;
+    target = NULL;
+    jobs = 0;
+    defines.count = 0;
+    release = false;
+    clean = false;
+    all = false;
+}
+
+// parses a writable copy of argv, as lists are split in place, and saves the result to buffer
+static size_t save(clags_spec_t *spec, int argc, char **tokens, char *buffer, size_t size)
+{
+    static char storage[1024];
+    char *argv[argc];
+    for (int i=0, used=0; i<argc; ++i){
+        argv[i] = storage+used;
+        used += sprintf(argv[i], "%s", tokens[i]) + 1;
+    }
+    clags_error_t error;
+    clags_settings_t settings = {.error=&error, .no_env=true};
+    clags_output_t output = clags_output_buffer(buffer, size);
+    if (!clags_parse_with(argc, argv, spec, &settings) || !clags_snapshot_save(spec, &output, &error)){
+        fprintf(stderr, "[ERROR] Could not save a snapshot of '%s'!\n", argv[argc-1]);
+        exit(1);
+    }
+    return output.length;
+}
+
+int main(void)
+{
+    size_t failures = 0;
+    clags_spec_t spec;
+    clags_compile(&spec, args);
+
+    static char with_command[4096];
+    char *argv[] = {"snapshot_test", "-v", "--name", "demo", "--sizes=1,2,3", "build", "app", "-j", "4", "--defines=A,B", "--release"};
+    size_t with_length = save(&spec, clags_arr_len(argv), argv, with_command, sizeof(with_command));
+    reset();
+    if (!clags_snapshot_load(&spec, with_command, with_length, NULL)){
+        fprintf(stderr, "[ERROR] Could not load the snapshot with a command!\n");
+        failures++;
+    } else if (!verbose || name == NULL || strcmp(name, "demo") != 0 || sizes.count != 3 || ((int32_t*) sizes.items)[2] != 3 ||
+               !build || target == NULL || strcmp(target, "app") != 0 || jobs != 4 || defines.count != 2 ||
+               strcmp(((char**) defines.items)[1], "B") != 0 || !release || clean || all){
+        fprintf(stderr, "[ERROR] The snapshot did not restore the table of the selected command!\n");
+        failures++;
+    }
+
+    // without a command the command tables are neither saved nor touched on load
+    static char without_command[4096];
+    char *plain_argv[] = {"snapshot_test", "--name", "plain"};
+    reset();
+    size_t length = save(&spec, clags_arr_len(plain_argv), plain_argv, without_command, sizeof(without_command));
+    build = true;
+    jobs = 7;
+    if (!clags_snapshot_load(&spec, without_command, length, NULL) || build || jobs != 7 || strcmp(name, "plain") != 0){
+        fprintf(stderr, "[ERROR] The snapshot without a command changed a command table!\n");
+        failures++;
+    }
+
+    clags_spec_t wide_spec;
+    clags_compile(&wide_spec, wide_args);
+    clags_error_t error;
+    clags_settings_t settings = {.error=&error};
+    if (clags_snapshot_load(&wide_spec, with_command, with_length, &settings) || error.code != Clags_Error_Input){
+        fprintf(stderr, "[ERROR] A snapshot was loaded by a table with a different command table!\n");
+        failures++;
+    }
+
+    clags_spec_free(&wide_spec);
+    clags_spec_free(&spec);
+    clags_list_free(&sizes);
+    clags_list_free(&defines);
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu checks failed!\n", failures);
+        return 1;
+    }
+    printf("snapshot_test: snapshots restore the tables of selected commands\n");
+    return 0;
+}
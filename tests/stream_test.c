@@ -0,0 +1,146 @@
+// Checks that streamed lists hand every item to the callback in order, from argv and from stdin after '-',
+// with items split across chunks, and that invalid, rejected and oversized items stop the parse.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// small chunks, so that most items of the inputs below are split between two reads
+#define CLAGS_STREAM_CHUNK_SIZE 16
+#define CLAGS_IMPLEMENTATION
+#include "../clags.h"
+
+#define TEST_INPUT "tests/stream_test.in"
+
+static char received[1024];
+static const char *reject = NULL;  // a token the callbacks refuse
+
+static bool on_int(void *item, void *ctx)
+{
+    (void) ctx;
+    char token[32];
+    snprintf(token, sizeof(token), "%d", *(int32_t*) item);
+    if (reject && strcmp(token, reject) == 0) return false;
+    size_t n = strlen(received);
+    snprintf(received+n, sizeof(received)-n, "%s,", token);
+    return true;
+}
+
+// string items from stdin point into the chunk buffer, so they are copied while the callback runs
+static bool on_word(void *item, void *ctx)
+{
+    (void) ctx;
+    const char *word = *(char**) item;
+    if (reject && strcmp(word, reject) == 0) return false;
+    size_t n = strlen(received);
+    snprintf(received+n, sizeof(received)-n, "[%s]", word);
+    return true;
+}
+
+static clags_stream_t ints;
+static clags_stream_t words;
+static bool verbose = false;
+
+typedef struct{
+    bool strings;        // streams words instead of int32 values
+    const char *line;    // the arguments, separated by spaces
+    const char *input;   // what stdin holds
+    const char *reject;
+    clags_error_code_t code;
+    const char *items;   // what the callback received, also compared after a failure
+    size_t count;
+} test_case_t;
+
+static const test_case_t cases[] = {
+    {false, "1 2 3", "", NULL, Clags_Error_None, "1,2,3,", 3},
+    {false, "5 - 6", " 1 22\n333\t4444 55555\n666666 7777777 88888888\r\n999999999", NULL, Clags_Error_None,
+     "5,1,22,333,4444,55555,666666,7777777,88888888,999999999,6,", 11},
+    {false, "-", "-1 +2\n\n\n   \t  -2147483648  2147483647 0000000000000", NULL, Clags_Error_None, "-1,2,-2147483648,2147483647,0,", 5},
+    {false, "- -v", "10 20", NULL, Clags_Error_None, "10,20,", 2},
+    {false, "-", "", NULL, Clags_Error_None, "", 0},
+    {false, "-", "   \n\t  ", NULL, Clags_Error_None, "", 0},
+    {false, "-", "1 2 x 4", NULL, Clags_Error_InvalidValue, "1,2,", 2},
+    {false, "-", "1 2 2147483648", NULL, Clags_Error_OutOfRange, "1,2,", 2},
+    {false, "-", "1 2 3 4 5 6 7 8 9 10", "7", Clags_Error_Rejected, "1,2,3,4,5,6,", 6},
+    {false, "0 7 -", "1", "7", Clags_Error_Rejected, "0,", 1},
+    {false, "-", "1 00000000000000000002 3", NULL, Clags_Error_Input, "1,", 1},
+    {true, "a -", "alpha beta\ngamma-delta  epsilon_with_15 zeta", NULL, Clags_Error_None,
+     "[a][alpha][beta][gamma-delta][epsilon_with_15][zeta]", 6},
+    {true, "-", "one two three", "two", Clags_Error_Rejected, "[one]", 1},
+};
+
+static bool write_input(const char *input)
+{
+    FILE *f = fopen(TEST_INPUT, "w");
+    if (f == NULL) return false;
+    fputs(input, f);
+    fclose(f);
+    return freopen(TEST_INPUT, "r", stdin) != NULL;
+}
+
+int main(void)
+{
+    clags_arg_t int_args[] = {
+        clags_required_int32_stream(&ints, "values", "the values"),
+        clags_flag("-v", "--verbose", &verbose, "verbose output", false),
+    };
+    clags_arg_t word_args[] = {
+        clags_required_stream(&words, "words", "the words"),
+        clags_flag("-v", "--verbose", &verbose, "verbose output", false),
+    };
+    clags_spec_t int_spec, word_spec;
+    if (!clags_compile(&int_spec, int_args) || !clags_compile(&word_spec, word_args)) return 1;
+
+    size_t failures = 0;
+    for (size_t i=0; i<clags_arr_len(cases); ++i){
+        if (!write_input(cases[i].input)){
+            fprintf(stderr, "[ERROR] Could not write %s!\n", TEST_INPUT);
+            return 1;
+        }
+        char line[256];
+        char *argv[16] = {"stream_test"};
+        int argc = 1;
+        snprintf(line, sizeof(line), "%s", cases[i].line);
+        for (char *token=strtok(line, " "); token; token=strtok(NULL, " ")) argv[argc++] = token;
+
+        ints = clags_int32_stream(on_int, NULL);
+        words = clags_stream(on_word, NULL);
+        received[0] = '\0';
+        reject = cases[i].reject;
+        clags_error_t error;
+        clags_settings_t settings = {.error=&error, .no_env=true};
+        bool result = clags_parse_with(argc, argv, cases[i].strings? &word_spec:&int_spec, &settings);
+        size_t count = cases[i].strings? words.count:ints.count;
+        if (result != (cases[i].code == Clags_Error_None) || error.code != cases[i].code ||
+            strcmp(received, cases[i].items) != 0 || count != cases[i].count){
+            fprintf(stderr, "[ERROR] '%s' with '%s': expected error %d and %zu items %s\n", cases[i].line, cases[i].input,
+                    cases[i].code, cases[i].count, cases[i].items);
+            fprintf(stderr, "  but got error %d (%s) and %zu items %s\n", error.code, error.message, count, received);
+            failures++;
+        }
+    }
+
+    // the chunk buffer comes from the allocator of the parse
+    char buffer[CLAGS_STREAM_CHUNK_SIZE];
+    clags_arena_t arena;
+    clags_arena_init(&arena, buffer, sizeof(buffer));
+    clags_allocator_t allocator = clags_arena_allocator(&arena);
+    clags_error_t error;
+    clags_settings_t settings = {.error=&error, .allocator=&allocator, .no_env=true};
+    char dash[] = "-";
+    char *argv[] = {"stream_test", dash};
+    if (!write_input("1 2") || clags_parse_with(clags_arr_len(argv), argv, &int_spec, &settings) || error.code != Clags_Error_Memory){
+        fprintf(stderr, "[ERROR] Streaming stdin did not fail without memory for the chunk buffer!\n");
+        failures++;
+    }
+
+    remove(TEST_INPUT);
+    clags_spec_free(&int_spec);
+    clags_spec_free(&word_spec);
+    if (failures){
+        fprintf(stderr, "[ERROR] %zu checks failed!\n", failures);
+        return 1;
+    }
+    printf("stream_test: %zu streams delivered their items as expected\n", clags_arr_len(cases));
+    return 0;
+}